@@ -120,6 +120,18 @@ config :archethic, Archethic.P2P.Message, floor_upload_speed: 125_000
 
 config :archethic, Archethic.SelfRepair.Sync, last_sync_file: "p2p/last_sync"
 
+# Trace each native port request stage (mailbox, pipe, native queue and service) for load tests
+# The native port requests received within the coalesce window (in ms) are written at once,
+# 0 coalesces only the requests already queued
+config :archethic, Archethic.Utils.PortHandler,
+  trace: System.get_env("ARCHETHIC_PORT_TRACE", "false") == "true",
+  coalesce_window: String.to_integer(System.get_env("ARCHETHIC_PORT_COALESCE_WINDOW", "0"))
+
+# Compress each transaction written in the chain and IO files,
+# the files can mix compressed and raw transactions
+config :archethic, Archethic.DB.EmbeddedImpl.ChainWriter,
+  compression: System.get_env("ARCHETHIC_DB_COMPRESSION", "false") == "true"
+
 # Default cachae size for the chain index is 300MB
 config :archethic,
        Archethic.DB.ChainIndex.MaxCacheSize,
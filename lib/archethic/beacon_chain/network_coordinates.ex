@@ -3,6 +3,12 @@ defmodule Archethic.BeaconChain.NetworkCoordinates do
   Network coordinates is a way to map latency between nodes and used to determine the closest nodes
   """
 
+  # Maximum time given to the native multidimensional scaling
+  @mds_timeout 30_000
+
+  # Protocol version from which the multidimensional scaling is computed natively
+  @native_mds_protocol_version 12
+
   @digits ["F", "E", "D", "C", "B", "A", "9", "8", "7", "6", "5", "4", "3", "2", "1", "0"]
 
   alias Archethic.BeaconChain
@@ -19,6 +25,12 @@ defmodule Archethic.BeaconChain.NetworkCoordinates do
   alias Archethic.P2P.Message.NetworkStats
 
   alias Archethic.SelfRepair
+  alias Archethic.SharedSecrets
+
+  alias Archethic.TransactionChain
+  alias Archethic.TransactionChain.Transaction
+  alias Archethic.TransactionChain.Transaction.ValidationStamp
+
   alias Archethic.Utils
 
   require Logger
@@ -49,15 +61,21 @@ defmodule Archethic.BeaconChain.NetworkCoordinates do
   eigenvalues and eigenvectors to find their corresponding coordinates.
 
   Then we transform the coordinates into hexadecimal digits
+
+  The decomposition depends on the protocol version agreed by the network
+  (see `network_protocol_version/1`)
   """
-  @spec get_patch_from_latencies(Nx.Tensor.t()) :: list(String.t())
-  def get_patch_from_latencies(matrix = %Nx.Tensor{}) do
+  @spec get_patch_from_latencies(Nx.Tensor.t(), protocol_version :: pos_integer()) ::
+          list(String.t())
+  def get_patch_from_latencies(matrix, protocol_version \\ network_protocol_version())
+
+  def get_patch_from_latencies(matrix = %Nx.Tensor{}, protocol_version) do
     if Nx.size(matrix) > 1 do
       start_time = System.monotonic_time()
 
       network_patches =
         matrix
-        |> get_matrix_coordinates()
+        |> get_matrix_coordinates(protocol_version)
         |> get_patch_digits()
 
       :telemetry.execute(
@@ -65,7 +83,7 @@ defmodule Archethic.BeaconChain.NetworkCoordinates do
         %{
           duration: System.monotonic_time() - start_time
         },
-        %{matrix_size: Nx.size(matrix)}
+        %{matrix_size: Nx.size(matrix), native?: native_mds?(protocol_version)}
       )
 
       network_patches
@@ -77,14 +95,86 @@ defmodule Archethic.BeaconChain.NetworkCoordinates do
   @doc """
   Computes the matrix coordinates from latency matrix between nodes
 
-  It returns a new matrix will the x, y coordinates of each node's network coordinate
+  It returns a new matrix will the x, y coordinates of each node's network coordinate.
+
+  The native computation orients the eigenvectors with its own sign convention, which can
+  mirror the coordinates given by `Nx.LinAlg.eigh/1`. As the patches of the beacon summaries
+  are averaged across nodes, it is only used once the network has agreed on the protocol
+  version #{@native_mds_protocol_version} (see `network_protocol_version/1`), so that all
+  the nodes switch together whatever the version of their own code.
+  """
+  @spec get_matrix_coordinates(Nx.Tensor.t(), protocol_version :: pos_integer()) ::
+          Nx.Tensor.t()
+  def get_matrix_coordinates(matrix, protocol_version \\ network_protocol_version())
+
+  def get_matrix_coordinates(matrix = %Nx.Tensor{}, protocol_version) do
+    if native_mds?(protocol_version) do
+      native_matrix_coordinates(matrix)
+    else
+      matrix
+      |> Nx.as_type(:f64)
+      |> matrix_multidimensional_scaling()
+      |> get_coordinates()
+    end
+  end
+
+  @doc """
+  Return the protocol version agreed by the network at the given time.
+
+  It is the protocol version the last node shared secrets transaction before this time was
+  validated with, so it is the same on every node, and it only changes once the validation
+  nodes run the new protocol. Before the first node shared secrets transaction, the first
+  protocol version is returned.
   """
-  @spec get_matrix_coordinates(Nx.Tensor.t()) :: Nx.Tensor.t()
-  def get_matrix_coordinates(matrix = %Nx.Tensor{}) do
-    matrix
-    |> Nx.as_type(:f64)
-    |> matrix_multidimensional_scaling()
-    |> get_coordinates()
+  @spec network_protocol_version(DateTime.t()) :: pos_integer()
+  def network_protocol_version(time = %DateTime{} \\ DateTime.utc_now()) do
+    with genesis_address when is_binary(genesis_address) <-
+           SharedSecrets.genesis_address(:node_shared_secrets),
+         {address, _} <- TransactionChain.get_last_address(genesis_address, time),
+         {:ok, %Transaction{validation_stamp: %ValidationStamp{protocol_version: version}}} <-
+           TransactionChain.get_transaction(address, validation_stamp: [:protocol_version]) do
+      version
+    else
+      _ -> 1
+    end
+  end
+
+  defp native_mds?(protocol_version), do: protocol_version >= @native_mds_protocol_version
+
+  defp native_matrix_coordinates(matrix) do
+    matrix_size = Nx.size(matrix[0])
+
+    # The multidimensional scaling is computed natively: the double centering of the matrix and
+    # the extraction of the two top eigenpairs only (instead of a full decomposition)
+    port =
+      Port.open({:spawn_executable, multidimensional_scaling_executable()}, [
+        :binary,
+        :exit_status,
+        packet: 4
+      ])
+
+    Port.command(port, [<<matrix_size::32>>, matrix |> Nx.as_type(:f64) |> Nx.to_binary()])
+
+    receive do
+      {^port, {:data, coordinates}} ->
+        # The executable exits once the coordinates are written
+        receive do
+          {^port, {:exit_status, _}} -> :ok
+        after
+          @mds_timeout -> Port.close(port)
+        end
+
+        coordinates
+        |> Nx.from_binary(:f64)
+        |> Nx.reshape({matrix_size, 2})
+
+      {^port, {:exit_status, status}} ->
+        raise "Multidimensional scaling failed with the exit status #{status}"
+    after
+      @mds_timeout ->
+        Port.close(port)
+        raise "Multidimensional scaling timed out"
+    end
   end
 
   defp matrix_multidimensional_scaling(matrix_tensor) do
@@ -148,6 +238,10 @@ defmodule Archethic.BeaconChain.NetworkCoordinates do
     Nx.multiply(top_eigen_vectors, top_eigen_values)
   end
 
+  defp multidimensional_scaling_executable do
+    Application.app_dir(:archethic, "/priv/c_dist/network_coordinates")
+  end
+
   defp get_patch_digits(coordinates_matrix) do
     transposed_matrix = Nx.transpose(coordinates_matrix)
     x = transposed_matrix[0]
@@ -161,20 +161,53 @@ defmodule Archethic.BeaconChain.ReplicationAttestation do
          },
          acc ->
         # Accumulate distinct confirmations in a replication attestation
+        # The confirmations already seen are tracked in a set to avoid rescanning the list
+        # each time a new attestation is merged
         acc =
-          Map.update(acc, address, attestation, fn reduced_attest ->
-            Map.update!(reduced_attest, :confirmations, &((&1 ++ confirmations) |> Enum.uniq()))
+          Map.update(acc, address, attestation, fn
+            {reduced_attest, seen, reversed_confirmations} ->
+              {seen, reversed_confirmations} =
+                merge_confirmations(confirmations, seen, reversed_confirmations)
+
+              {reduced_attest, seen, reversed_confirmations}
+
+            reduced_attest = %__MODULE__{confirmations: previous_confirmations} ->
+              {seen, reversed_confirmations} =
+                merge_confirmations(previous_confirmations ++ confirmations, MapSet.new(), [])
+
+              {reduced_attest, seen, reversed_confirmations}
           end)
 
         {[], acc}
       end,
       # last function, return acc in the enumeration
-      fn acc -> {Map.values(acc), acc} end,
+      fn acc ->
+        reduced_attestations =
+          Enum.map(acc, fn
+            {_, {reduced_attest, _, reversed_confirmations}} ->
+              %__MODULE__{reduced_attest | confirmations: Enum.reverse(reversed_confirmations)}
+
+            {_, reduced_attest} ->
+              reduced_attest
+          end)
+
+        {reduced_attestations, acc}
+      end,
       # after function, do nothing
       fn _ -> :ok end
     )
   end
 
+  defp merge_confirmations(confirmations, seen, reversed_confirmations) do
+    Enum.reduce(confirmations, {seen, reversed_confirmations}, &merge_confirmation/2)
+  end
+
+  defp merge_confirmation(confirmation, acc = {seen, reversed_confirmations}) do
+    if MapSet.member?(seen, confirmation),
+      do: acc,
+      else: {MapSet.put(seen, confirmation), [confirmation | reversed_confirmations]}
+  end
+
   @doc """
   Return true if the attestation reached the minimum confirmations threshold
   """
@@ -381,8 +381,11 @@ defmodule Archethic.BeaconChain.Subset do
         end)
         |> Enum.map(fn {_, index} -> index end)
 
+      # Every node of the subset computes the patches with the protocol of the summary time
+      protocol_version = NetworkCoordinates.network_protocol_version(summary_time)
+
       StatsCollector.fetch(summary_time, timeout)
-      |> NetworkCoordinates.get_patch_from_latencies()
+      |> NetworkCoordinates.get_patch_from_latencies(protocol_version)
       |> Enum.with_index()
       |> Enum.filter(fn {_, index} ->
         index in sampling_nodes_indexes
@@ -176,25 +176,56 @@ defmodule Archethic.BeaconChain.SummaryAggregate do
   end
 
   defp aggregate_node_availabilities(node_availabilities) do
-    node_availabilities
-    |> filter_p2p_view_size_by_frequency()
-    |> Enum.zip()
-    |> Enum.map(&Tuple.to_list/1)
-    |> Enum.map(fn availabilities ->
-      # Get the mode of the availabilities
-      frequencies = Enum.frequencies(availabilities)
-      online_frequencies = Map.get(frequencies, 1, 0)
-      offline_frequencies = Map.get(frequencies, 0, 0)
-
-      if online_frequencies >= offline_frequencies do
-        1
-      else
-        0
-      end
-    end)
-    |> List.flatten()
-    |> Enum.map(&<<&1::1>>)
-    |> :erlang.list_to_bitstring()
+    case filter_p2p_view_size_by_frequency(node_availabilities) do
+      [] ->
+        <<>>
+
+      views = [view | _] ->
+        # Each view is handled as an integer bitmap and the online votes of every node are
+        # counted at once with bit-sliced counters (the bit i of the counter plane j is
+        # the bit j of the node i's count), so the cost depends on the number of views
+        # and not on the number of nodes
+        nb_views = length(views)
+
+        online =
+          views
+          |> Enum.map(&Integer.undigits(&1, 2))
+          |> Enum.reduce([], &add_to_counters/2)
+          # Mode of the availabilities: online if online >= offline
+          |> counters_greater_or_equal(div(nb_views + 1, 2), length(view))
+
+        <<online::size(length(view))>>
+    end
+  end
+
+  defp add_to_counters(0, planes), do: planes
+  defp add_to_counters(carry, []), do: [carry]
+
+  defp add_to_counters(carry, [plane | rest]) do
+    [Bitwise.bxor(plane, carry) | add_to_counters(Bitwise.band(plane, carry), rest)]
+  end
+
+  defp counters_greater_or_equal(planes, threshold, nb_nodes) do
+    all_nodes = Bitwise.bsl(1, nb_nodes) - 1
+    nb_planes = max(length(planes), Integer.digits(threshold, 2) |> length())
+    planes = planes ++ List.duplicate(0, nb_planes - length(planes))
+
+    # Compare from the most significant plane, keeping the nodes strictly greater and the
+    # ones still equal to the threshold
+    {greater, equal} =
+      planes
+      |> Enum.with_index()
+      |> Enum.reverse()
+      |> Enum.reduce({0, all_nodes}, fn {plane, index}, {greater, equal} ->
+        if Bitwise.band(threshold, Bitwise.bsl(1, index)) == 0 do
+          {Bitwise.bor(greater, Bitwise.band(equal, plane)),
+           Bitwise.band(equal, Bitwise.bxor(plane, all_nodes))}
+        else
+          {greater, Bitwise.band(equal, plane)}
+        end
+      end)
+
+    Bitwise.bor(greater, equal)
   end
 
   defp aggregate_node_average_availabilities(avg_availabilities) do
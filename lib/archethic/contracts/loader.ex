@@ -42,11 +42,11 @@ defmodule Archethic.Contracts.Loader do
     :ets.new(@invalid_call_table, [:bag, :named_table, :public, read_concurrency: true])
 
     node_key = Crypto.first_node_public_key()
-    authorized_nodes = P2P.authorized_and_available_nodes()
+    storage_election = Election.chain_storage_election(P2P.authorized_and_available_nodes())
 
     # Network transactions does not contains trigger or recipient
     TransactionChain.list_genesis_addresses()
-    |> Stream.filter(&Election.chain_storage_node?(&1, node_key, authorized_nodes))
+    |> Stream.filter(&Election.chain_storage_node?(&1, node_key, storage_election))
     |> Stream.chunk_every(100)
     |> Task.async_stream(
       fn genesis_addresses ->
@@ -607,17 +607,19 @@ defmodule Archethic.Crypto do
 
     curve = ID.to_curve(curve_id)
 
-    {ephemeral_public_key, ephemeral_private_key} = generate_ephemeral_encryption_keys(curve)
-
-    # Derivate secret using ECDH with the given public key and the ephemeral private key
-    shared_key =
+    # Derivate secret using ECDH with the given public key and an ephemeral private key
+    {ephemeral_public_key, shared_key} =
       case curve do
         :ed25519 ->
-          x25519_pk = Ed25519.convert_to_x25519_public_key(public_key)
-          :crypto.compute_key(:ecdh, x25519_pk, ephemeral_private_key, :x25519)
+          # The ephemeral keypair is taken from the pool of keys generated in advance by the
+          # native port, and the ECDH is done natively with the x25519 conversion of the key
+          Ed25519.ephemeral_shared_key(public_key)
 
         _ ->
-          :crypto.compute_key(:ecdh, public_key, ephemeral_private_key, curve)
+          {ephemeral_public_key, ephemeral_private_key} = :crypto.generate_key(:ecdh, curve)
+
+          {ephemeral_public_key,
+           :crypto.compute_key(:ecdh, public_key, ephemeral_private_key, curve)}
       end
 
     # Generate keys for the AES authenticated encryption
@@ -633,9 +635,6 @@ defmodule Archethic.Crypto do
     <<ephemeral_public_key::binary, tag::binary, cipher::binary>>
   end
 
-  defp generate_ephemeral_encryption_keys(:ed25519), do: :crypto.generate_key(:ecdh, :x25519)
-  defp generate_ephemeral_encryption_keys(curve), do: :crypto.generate_key(:ecdh, curve)
-
   defp derivate_secrets(dh_key) do
     pseudorandom_key = :crypto.hash(:sha256, dh_key)
     iv = binary_part(:crypto.mac(:hmac, :sha256, pseudorandom_key, "0"), 0, 32)
@@ -43,6 +43,31 @@ defmodule Archethic.Crypto.Ed25519 do
     x25519_pub
   end
 
+  @doc """
+  Derive a shared key with the x25519 conversion of the given ed25519 public key using a
+  single-use x25519 keypair.
+
+  It returns the ephemeral x25519 public key and the shared key
+  """
+  @spec ephemeral_shared_key(binary()) :: {binary(), binary()}
+  def ephemeral_shared_key(ed25519_public_key) do
+    start_time = System.monotonic_time()
+    res = LibSodiumPort.ephemeral_shared_key(ed25519_public_key)
+
+    :telemetry.execute([:archethic, :crypto, :libsodium], %{
+      duration: System.monotonic_time() - start_time
+    })
+
+    case res do
+      {:ok, keys} ->
+        keys
+
+      {:error, reason} ->
+        # Raised as the ECDH of :crypto does for an invalid or low order public key
+        raise ErlangError, original: {:error, "Cannot compute the shared key: #{reason}"}
+    end
+  end
+
   @doc """
   Convert a ed25519 secret key into a x25519
   """
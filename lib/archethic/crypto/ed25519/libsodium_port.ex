@@ -7,6 +7,14 @@ defmodule Archethic.Crypto.Ed25519.LibSodiumPort do
 
   @table_name :libsodium_port
 
+  @function_names %{
+    1 => :convert_public_key,
+    2 => :convert_secret_key,
+    3 => :ephemeral_shared_key,
+    4 => :ephemeral_pool_depth,
+    255 => :stats
+  }
+
   alias Archethic.Utils.PortHandler
 
   def start_link(opts \\ []) do
@@ -31,6 +39,69 @@ defmodule Archethic.Crypto.Ed25519.LibSodiumPort do
     PortHandler.request(port_handler, 2, secret_key)
   end
 
+  @doc """
+  Derive a shared key with the x25519 conversion of the ed25519 public key, using a
+  single-use x25519 keypair taken from the pool filled in background by the port.
+
+  The ephemeral secret key never leaves the port
+  """
+  @spec ephemeral_shared_key(binary()) ::
+          {:ok, {ephemeral_public_key :: binary(), shared_key :: binary()}}
+          | {:error, String.t()}
+  def ephemeral_shared_key(<<public_key::binary-32>>) do
+    [{_, port_handler}] = :ets.lookup(@table_name, :port)
+
+    case PortHandler.request(port_handler, 3, public_key) do
+      {:ok, <<ephemeral_public_key::binary-32, shared_key::binary-32>>} ->
+        {:ok, {ephemeral_public_key, shared_key}}
+
+      {:error, _} = e ->
+        e
+    end
+  end
+
+  @doc """
+  Return the number of ephemeral keypairs available in the pool
+  """
+  @spec ephemeral_pool_depth() :: {:ok, non_neg_integer()} | {:error, String.t()}
+  def ephemeral_pool_depth do
+    [{_, port_handler}] = :ets.lookup(@table_name, :port)
+
+    case PortHandler.request(port_handler, 4, <<>>) do
+      {:ok, <<depth::32>>} -> {:ok, depth}
+      {:error, _} = e -> e
+    end
+  end
+
+  @doc """
+  Return the native latency histograms of the port
+  """
+  @spec stats() :: {:ok, map()} | {:error, String.t()}
+  def stats do
+    [{_, port_handler}] = :ets.lookup(@table_name, :port)
+    PortHandler.stats(port_handler)
+  end
+
+  @doc """
+  Emit the native latency histograms of the port as telemetry events
+  """
+  @spec emit_stats() :: :ok
+  def emit_stats do
+    [{_, port_handler}] = :ets.lookup(@table_name, :port)
+    PortHandler.emit_stats(port_handler, :libsodium, @function_names)
+
+    case ephemeral_pool_depth() do
+      {:ok, depth} ->
+        :telemetry.execute([:archethic, :crypto, :ephemeral_key_pool], %{depth: depth})
+
+      {:error, _} ->
+        :ok
+    end
+  catch
+    # The poller must survive a busy or restarting port
+    :exit, _ -> :ok
+  end
+
   def init(_opts) do
     libsodium = Application.app_dir(:archethic, "/priv/c_dist/libsodium_port")
 
@@ -9,6 +9,14 @@ defmodule Archethic.Crypto.NodeKeystore.Origin.TPMImpl do
 
   @behaviour Origin
 
+  @function_names %{
+    1 => :initialize,
+    2 => :get_public_key,
+    3 => :sign_ecdsa,
+    4 => :retrieve_node_seed,
+    255 => :stats
+  }
+
   require Logger
 
   use GenServer
@@ -36,6 +44,21 @@ defmodule Archethic.Crypto.NodeKeystore.Origin.TPMImpl do
     GenServer.call(__MODULE__, :retrieve_node_seed)
   end
 
+  @doc """
+  Emit the native latency histograms of the TPM port as telemetry events
+  """
+  @spec emit_stats() :: :ok
+  def emit_stats do
+    case Process.whereis(__MODULE__) do
+      nil ->
+        :ok
+
+      pid ->
+        port_handler = GenServer.call(pid, :port_handler)
+        PortHandler.emit_stats(port_handler, :tpm, @function_names)
+    end
+  end
+
   @impl GenServer
   def init(_) do
     tpm_program = Application.app_dir(:archethic, "priv/c_dist/tpm_port")
@@ -59,8 +82,14 @@ defmodule Archethic.Crypto.NodeKeystore.Origin.TPMImpl do
     {:noreply, Map.update!(state, :async_tasks, &Map.put(&1, ref, from))}
   end
 
-  def handle_call(:retrieve_node_seed, _from, state = %{port_handler: port_handler}) do
-    {:reply, retrieve_node_seed(port_handler), state}
+  def handle_call(:port_handler, _from, state = %{port_handler: port_handler}) do
+    {:reply, port_handler, state}
+  end
+
+  def handle_call(:retrieve_node_seed, from, state = %{port_handler: port_handler}) do
+    # The port answers from its cached seed without waiting for pending TPM commands
+    %Task{ref: ref} = Task.async(fn -> retrieve_node_seed(port_handler) end)
+    {:noreply, Map.update!(state, :async_tasks, &Map.put(&1, ref, from))}
   end
 
   @impl GenServer
@@ -10,16 +10,23 @@ defmodule Archethic.DB.EmbeddedImpl.ChainIndex do
   alias Archethic.DB
   alias Archethic.DB.EmbeddedImpl.ChainWriter
   alias Archethic.TransactionChain.Transaction
+  alias Archethic.Utils.PortHandler
   alias ArchethicCache.LRU
 
   @archethic_db_chain_stats :archethic_db_chain_stats
   @archethic_db_last_index :archethic_db_last_index
   @archethic_db_type_stats :archethic_db_type_stats
   @archetic_db_tx_index_cache :chain_index_cache
+  @archethic_db_summary_index :archethic_db_summary_index
+
+  @summary_index_functions %{1 => :open, 2 => :lookup, 3 => :add, 4 => :scan, 255 => :stats}
 
   # 100 Ko
   @batch_read_size 102_400
 
+  # Time given to the summary index to answer a lookup before scanning the summary file
+  @summary_lookup_timeout 1_000
+
   require Logger
 
   def start_link(arg \\ []) do
@@ -30,71 +37,121 @@ defmodule Archethic.DB.EmbeddedImpl.ChainIndex do
     db_path = Keyword.fetch!(opts, :path)
     Logger.info("Index database at #{db_path}")
 
+    # A crash of the summary index must not take down the index tables,
+    # its port handler is restarted instead
+    Process.flag(:trap_exit, true)
+
     setup_ets_table()
+    port_handler = start_summary_index(db_path)
 
     fill_tables(db_path)
 
-    {:ok, %{db_path: db_path}}
+    {:ok, %{db_path: db_path, summary_index: port_handler}}
   end
 
   def setup_ets_table do
     :ets.new(@archethic_db_chain_stats, [:set, :named_table, :public, read_concurrency: true])
     :ets.new(@archethic_db_last_index, [:set, :named_table, :public, read_concurrency: true])
     :ets.new(@archethic_db_type_stats, [:set, :named_table, :public, read_concurrency: true])
+    :ets.new(@archethic_db_summary_index, [:set, :named_table, read_concurrency: true])
+  end
+
+  def handle_info(
+        {:EXIT, port_handler, reason},
+        state = %{db_path: db_path, summary_index: port_handler}
+      ) do
+    # The lookups scan the summary files until the index is opened again
+    Logger.error("Summary index exited (#{inspect(reason)}), restarting it")
+    {:noreply, %{state | summary_index: start_summary_index(db_path)}}
+  end
+
+  def handle_info({:EXIT, _pid, _reason}, state), do: {:noreply, state}
+
+  def terminate(_reason, %{summary_index: port_handler}) do
+    # Closing the port lets the summary index save its Bloom filters
+    GenServer.stop(port_handler)
+  catch
+    :exit, _ -> :ok
+  end
+
+  # The summary files are indexed by address in a native port to avoid
+  # scanning a whole subset for every lookup missing the cache, and filtered
+  # by subset to answer the lookups of missing addresses from memory
+  defp start_summary_index(db_path) do
+    program = Application.app_dir(:archethic, "/priv/c_dist/summary_index")
+    {:ok, port_handler} = PortHandler.start_link(program: program)
+
+    # The Bloom filters missing or outdated are rebuilt from the summary files
+    :ok = PortHandler.request(port_handler, 1, ChainWriter.base_chain_path(db_path), :infinity)
+
+    :ets.insert(@archethic_db_summary_index, {:port, port_handler})
+    port_handler
+  end
+
+  @doc """
+  Emit the native latency histograms of the summary index as telemetry events
+  """
+  @spec emit_stats() :: :ok
+  def emit_stats do
+    case :ets.whereis(@archethic_db_summary_index) do
+      :undefined ->
+        :ok
+
+      _ ->
+        [{_, port_handler}] = :ets.lookup(@archethic_db_summary_index, :port)
+        PortHandler.emit_stats(port_handler, :summary_index, @summary_index_functions)
+    end
   end
 
   defp fill_tables(db_path) do
-    Task.async_stream(
-      0..255,
-      fn subset ->
-        subset_summary_filename = index_summary_path(db_path, subset)
-        scan_summary_table(subset_summary_filename)
-      end,
-      timeout: :infinity,
-      max_concurrency: 16
-    )
-    |> Stream.run()
+    [{_, port_handler}] = :ets.lookup(@archethic_db_summary_index, :port)
+    until = DateTime.utc_now() |> DateTime.to_unix(:millisecond)
+
+    case PortHandler.request(port_handler, 4, <<until::64>>, :infinity) do
+      {:ok, chains} ->
+        insert_chains(chains)
+
+      :ok ->
+        # Without chain stats, the last addresses are listed from the chain files
+        fill_last_addresses(db_path)
+
+      {:error, reason} ->
+        Logger.warning("Cannot scan the chain stats (#{reason}), listing the chain files")
+        fill_last_addresses(db_path)
+    end
 
-    fill_last_addresses(db_path)
     fill_type_stats(db_path)
   end
 
-  defp scan_summary_table(filename) do
-    filename
-    |> File.stream!([], @batch_read_size)
-    |> Enum.reduce(<<>>, fn content, acc ->
-      do_scan_summary_table(<<acc::bitstring, content::bitstring>>)
-    end)
-  rescue
-    _ -> :ok
+  # Bulk insert the chain stats and last addresses aggregated by the native scan
+  defp insert_chains(chains, chain_stats \\ [], last_addresses \\ [])
+
+  defp insert_chains(<<>>, chain_stats, last_addresses) do
+    true = :ets.insert(@archethic_db_chain_stats, chain_stats)
+    true = :ets.insert(@archethic_db_last_index, last_addresses)
   end
 
-  defp do_scan_summary_table(<<>>), do: <<>>
+  defp insert_chains(
+         <<genesis_curve_id::8, genesis_hash_type::8, rest::binary>>,
+         chain_stats,
+         last_addresses
+       ) do
+    genesis_size = Crypto.hash_size(genesis_hash_type)
 
-  defp do_scan_summary_table(content) do
-    with <<_current_curve_id::8, current_hash_type::8, rest::bitstring>> <- content,
-         hash_size <- Crypto.hash_size(current_hash_type),
-         <<_current_digest::binary-size(hash_size), genesis_curve_id::8, genesis_hash_type::8,
-           rest::bitstring>> <- rest,
-         hash_size <- Crypto.hash_size(genesis_hash_type),
-         <<genesis_digest::binary-size(hash_size), size::32, _offset::32, rest::bitstring>> <-
-           rest do
-      genesis_address = <<genesis_curve_id::8, genesis_hash_type::8, genesis_digest::binary>>
+    <<genesis_digest::binary-size(genesis_size), size::64, nb_txs::32, last_curve_id::8,
+      last_hash_type::8, rest::binary>> = rest
 
-      :ets.update_counter(
-        @archethic_db_chain_stats,
-        genesis_address,
-        [
-          {2, size},
-          {3, 1}
-        ],
-        {genesis_address, 0, 0}
-      )
+    last_size = Crypto.hash_size(last_hash_type)
+    <<last_digest::binary-size(last_size), last_time::64, rest::binary>> = rest
 
-      do_scan_summary_table(rest)
-    else
-      _rest -> content
-    end
+    genesis_address = <<genesis_curve_id::8, genesis_hash_type::8, genesis_digest::binary>>
+    last_address = <<last_curve_id::8, last_hash_type::8, last_digest::binary>>
+
+    insert_chains(
+      rest,
+      [{genesis_address, size, nb_txs} | chain_stats],
+      [{genesis_address, last_address, last_time} | last_addresses]
+    )
   end
 
   defp fill_last_addresses(db_path) do
@@ -167,6 +224,8 @@ defmodule Archethic.DB.EmbeddedImpl.ChainIndex do
       [:binary, :append]
     )
 
+    register_summary_entry(tx_address)
+
     # pre-cache item (when node is not bootstrapping)
     # so they are already cached when we'll need them
     add_entry_to_cache(tx_address, %{
@@ -188,6 +247,20 @@ defmodule Archethic.DB.EmbeddedImpl.ChainIndex do
     :ok
   end
 
+  # Update the Bloom filter of the native index, so lookups of missing
+  # addresses are answered from memory.
+  # The transaction is already written, so the writer doesn't wait for the port
+  defp register_summary_entry(tx_address) do
+    case :ets.whereis(@archethic_db_summary_index) do
+      :undefined ->
+        :ok
+
+      _ ->
+        [{_, port_handler}] = :ets.lookup(@archethic_db_summary_index, :port)
+        PortHandler.cast(port_handler, 3, tx_address)
+    end
+  end
+
   @spec get_file_stats(binary()) ::
           {offset :: non_neg_integer(), nb_transactions :: non_neg_integer()}
   def get_file_stats(genesis_address) do
@@ -249,7 +322,44 @@ defmodule Archethic.DB.EmbeddedImpl.ChainIndex do
     end
   end
 
-  defp search_tx_entry(search_address = <<_::8, _::8, digest::binary>>, db_path) do
+  defp search_tx_entry(search_address, db_path) do
+    case :ets.whereis(@archethic_db_summary_index) do
+      # The index is not started when the database is used outside of the node
+      :undefined ->
+        scan_tx_entry(search_address, db_path)
+
+      _ ->
+        [{_, port_handler}] = :ets.lookup(@archethic_db_summary_index, :port)
+        lookup_tx_entry(port_handler, search_address, db_path)
+    end
+  end
+
+  defp lookup_tx_entry(port_handler, search_address, db_path) do
+    case PortHandler.request(port_handler, 2, search_address, @summary_lookup_timeout) do
+      {:ok, entry} ->
+        genesis_size = byte_size(entry) - 8
+        <<genesis_address::binary-size(genesis_size), size::32, offset::32>> = entry
+        {:ok, %{genesis_address: genesis_address, size: size, offset: offset}}
+
+      # The index answers the missing addresses without data
+      :ok ->
+        {:error, :not_exists}
+
+      {:error, reason} ->
+        fallback_tx_entry(search_address, db_path, reason)
+    end
+  catch
+    # A busy or restarting index must not fail the reads, the summary file is scanned instead
+    :exit, reason -> fallback_tx_entry(search_address, db_path, inspect(reason))
+  end
+
+  defp fallback_tx_entry(search_address, db_path, reason) do
+    Logger.warning("Summary index lookup failed (#{reason}), scanning the subset")
+    :telemetry.execute([:archethic, :db, :summary_index, :lookup_fallback], %{count: 1})
+    scan_tx_entry(search_address, db_path)
+  end
+
+  defp scan_tx_entry(search_address = <<_::8, _::8, digest::binary>>, db_path) do
     <<subset::8, _::binary>> = digest
 
     db_path
@@ -28,7 +28,9 @@ defmodule Archethic.DB.EmbeddedImpl.ChainReader do
         # Open the file as the position from the transaction in the chain file
         fd = File.open!(filepath, [:binary, :read])
 
-        {:ok, <<size::32, version::32>>} = :file.pread(fd, offset, 8)
+        {:ok, <<size::32, compressed::1, version::31>>} = :file.pread(fd, offset, 8)
+        {:ok, data} = :file.pread(fd, offset + 8, size)
+        data = maybe_decompress(data, compressed)
         column_names = fields_to_column_names(fields)
 
         # Ensure the validation stamp's protocol version is retrieved if we fetch validation stamp fields
@@ -45,11 +47,10 @@ defmodule Archethic.DB.EmbeddedImpl.ChainReader do
             column_names
           end
 
-        # Read the transaction and extract requested columns from the fields arg
+        # Extract requested columns from the fields arg
         tx =
-          fd
-          |> read_transaction(column_names, size, 0)
-          |> Enum.into(%{})
+          data
+          |> project_columns(column_names, fd)
           |> decode_transaction_columns(version)
 
         File.close(fd)
@@ -160,7 +161,8 @@ defmodule Archethic.DB.EmbeddedImpl.ChainReader do
   def stream_chain(genesis_address, fields, db_path) do
     filepath = ChainWriter.chain_path(db_path, genesis_address)
 
-    case File.open(filepath, [:binary, :read]) do
+    # The transactions are read sequentially, so the reads are buffered
+    case File.open(filepath, [:binary, :read, :read_ahead]) do
       {:ok, fd} ->
         Stream.resource(
           fn -> process_get_chain(fd, fields, [], db_path) end,
@@ -230,7 +232,9 @@ defmodule Archethic.DB.EmbeddedImpl.ChainReader do
     # Open the file as the position from the transaction in the chain file
     fd = File.open!(filepath, [:binary, :read])
 
-    {:ok, <<size::32, version::32>>} = :file.read(fd, 8)
+    {:ok, <<size::32, compressed::1, version::31>>} = :file.read(fd, 8)
+    {:ok, data} = :file.read(fd, size)
+    data = maybe_decompress(data, compressed)
     column_names = fields_to_column_names(fields)
 
     # Ensure the validation stamp's protocol version is retrieved if we fetch validation stamp fields
@@ -249,9 +253,8 @@ defmodule Archethic.DB.EmbeddedImpl.ChainReader do
 
     # Read the transaction and extract requested columns from the fields arg
     tx =
-      fd
-      |> read_transaction(column_names, size, 0)
-      |> Enum.into(%{})
+      data
+      |> project_columns(column_names, fd)
       |> decode_transaction_columns(version)
 
     File.close(fd)
@@ -260,7 +263,7 @@ defmodule Archethic.DB.EmbeddedImpl.ChainReader do
   end
 
   defp get_chain(filepath, db_path, fields, genesis_address, opts) do
-    fd = File.open!(filepath, [:binary, :read])
+    fd = File.open!(filepath, [:binary, :read, :read_ahead])
 
     {transactions, more?, paging_address} =
       case Keyword.get(opts, :order, :asc) do
@@ -385,14 +388,17 @@ defmodule Archethic.DB.EmbeddedImpl.ChainReader do
 
   defp get_paginated_chain(fd, fields, acc \\ []) do
     case :file.read(fd, 8) do
-      {:ok, <<size::32, version::32>>} ->
+      {:ok, <<size::32, compressed::1, version::31>>} ->
         if length(acc) == @page_size do
           %Transaction{address: address} = List.first(acc)
           {Enum.reverse(acc), true, address}
         else
+          {:ok, data} = :file.read(fd, size)
+
           tx =
-            fd
-            |> read_transaction(fields, size, 0)
+            data
+            |> maybe_decompress(compressed)
+            |> project_columns(fields, fd)
             |> decode_transaction_columns(version)
 
           get_paginated_chain(fd, fields, [tx | acc])
@@ -403,50 +409,75 @@ defmodule Archethic.DB.EmbeddedImpl.ChainReader do
     end
   end
 
-  defp read_transaction(fd, fields, limit, position, acc \\ %{})
+  defp maybe_decompress(data, 0), do: data
+  defp maybe_decompress(data, 1), do: Encoding.decompress(data)
+
+  @doc """
+  Extract the columns of an encoded transaction matching the column names (or all the columns
+  if no column name is given).
+
+  The whole transaction is read at once, so the values returned are sub-binaries of the data read
+  instead of reading (or skipping) each column from the file.
+
+  ## Examples
+
+      iex> ChainReader.project_columns(
+      ...>   <<7::8, 2::32, "address", 0, 1, 4::8, 1::32, "type", 253,
+      ...>     26::8, 8::32, "validation_stamp.timestamp", 0::64>>,
+      ...>   ["address", "validation_stamp"]
+      ...> )
+      %{"address" => <<0, 1>>, "validation_stamp.timestamp" => <<0::64>>}
+  """
+  @spec project_columns(binary(), list(binary()), pid() | nil) :: %{binary() => binary()}
+  def project_columns(data, column_names, fd \\ nil)
 
   # this prevent an infinite loop in case of corrupted file
-  defp read_transaction(fd, _fields, 0, _position, _acc) do
-    {:ok, filename} = :file.pid2name(fd)
-    raise %RuntimeError{message: "Corrupted file: #{filename}"}
+  def project_columns(<<>>, _column_names, fd), do: raise_corrupted(fd)
+
+  # All the columns are kept, so they can reference the data instead of copying it
+  def project_columns(data, [], fd),
+    do: do_project_columns(data, fn _ -> true end, false, fd, %{})
+
+  def project_columns(data, column_names, fd) do
+    nested_prefixes = Enum.map(column_names, &(&1 <> "."))
+
+    # Check if we need to take the column based on the selection criteria,
+    # either matching a field or a nested field
+    selected? = fn column_name ->
+      column_name in column_names or String.starts_with?(column_name, nested_prefixes)
+    end
+
+    # The selected values are copied, otherwise they would keep the whole data alive
+    do_project_columns(data, selected?, true, fd, %{})
   end
 
-  defp read_transaction(_fd, _fields, limit, position, acc) when limit == position, do: acc
+  defp do_project_columns(<<>>, _selected?, _copy?, _fd, acc), do: acc
+
+  defp do_project_columns(
+         <<column_name_size::8, value_size::32, column_name::binary-size(column_name_size),
+           value::binary-size(value_size), rest::binary>>,
+         selected?,
+         copy?,
+         fd,
+         acc
+       ) do
+    acc =
+      cond do
+        not selected?.(column_name) -> acc
+        copy? -> Map.put(acc, :binary.copy(column_name), :binary.copy(value))
+        true -> Map.put(acc, column_name, value)
+      end
 
-  defp read_transaction(fd, fields, limit, position, acc) do
-    case :file.read(fd, 5) do
-      {:ok, <<column_name_size::8, value_size::32>>} ->
-        {:ok, <<column_name::binary-size(column_name_size)>>} = :file.read(fd, column_name_size)
+    do_project_columns(rest, selected?, copy?, fd, acc)
+  end
 
-        position = position + 5 + column_name_size + value_size
+  defp do_project_columns(_, _selected?, _copy?, fd, _acc), do: raise_corrupted(fd)
 
-        # Without field selection we take all the fields of the transaction
-        if fields == [] do
-          {:ok, <<value::binary-size(value_size)>>} = :file.read(fd, value_size)
-          read_transaction(fd, fields, limit, position, Map.put(acc, column_name, value))
-        else
-          # Check if we need to take this field based on the selection criteria
-          cond do
-            column_name in fields ->
-              # match a field
-              {:ok, <<value::binary-size(value_size)>>} = :file.read(fd, value_size)
-              read_transaction(fd, fields, limit, position, Map.put(acc, column_name, value))
-
-            Enum.any?(fields, &String.starts_with?(column_name, &1 <> ".")) ->
-              # match a nested field
-              {:ok, <<value::binary-size(value_size)>>} = :file.read(fd, value_size)
-              read_transaction(fd, fields, limit, position, Map.put(acc, column_name, value))
-
-            true ->
-              # We continue to the next as the selection critieria didn't match
-              :file.position(fd, {:cur, value_size})
-              read_transaction(fd, fields, limit, position, acc)
-          end
-        end
+  defp raise_corrupted(nil), do: raise(%RuntimeError{message: "Corrupted transaction"})
 
-      :eof ->
-        acc
-    end
+  defp raise_corrupted(fd) do
+    {:ok, filename} = :file.pid2name(fd)
+    raise %RuntimeError{message: "Corrupted file: #{filename}"}
   end
 
   @doc """
@@ -45,7 +45,7 @@ defmodule Archethic.DB.EmbeddedImpl.ChainWriter do
 
       filename = io_path(db_path, address)
 
-      data = Encoding.encode(tx)
+      data = encode_transaction(tx)
 
       File.write!(
         filename,
@@ -159,7 +159,7 @@ defmodule Archethic.DB.EmbeddedImpl.ChainWriter do
 
     filename = chain_path(db_path, genesis_address)
 
-    data = Encoding.encode(tx)
+    data = encode_transaction(tx)
 
     File.write!(
       filename,
@@ -174,6 +174,20 @@ defmodule Archethic.DB.EmbeddedImpl.ChainWriter do
     })
   end
 
+  # The transactions can be compressed one by one (see Encoding.compress/1),
+  # so their size and offset in the chain file stay their addressing
+  defp encode_transaction(tx) do
+    data = Encoding.encode(tx)
+
+    if compression?(), do: Encoding.compress(data), else: data
+  end
+
+  defp compression? do
+    :archethic
+    |> Application.get_env(__MODULE__, [])
+    |> Keyword.get(:compression, false)
+  end
+
   defp index_transaction(
          %Transaction{
            address: tx_address,
@@ -25,6 +25,39 @@ defmodule Archethic.DB.EmbeddedImpl.Encoding do
   alias Archethic.Utils
   alias Archethic.Utils.VarInt
 
+  # Columns in the order of their encoding, used as compression dictionary:
+  # they are repeated in every transaction, which is compressed independently
+  @columns [
+    "address",
+    "type",
+    "data.content",
+    "data.code",
+    "data.contract",
+    "data.ledger.uco",
+    "data.ledger.token",
+    "data.ownerships",
+    "data.recipients",
+    "previous_public_key",
+    "previous_signature",
+    "origin_signature",
+    "validation_stamp.timestamp",
+    "validation_stamp.proof_of_work",
+    "validation_stamp.proof_of_election",
+    "validation_stamp.proof_of_integrity",
+    "validation_stamp.ledger_operations.transaction_movements",
+    "validation_stamp.ledger_operations.unspent_outputs",
+    "validation_stamp.ledger_operations.consumed_inputs",
+    "validation_stamp.ledger_operations.fee",
+    "validation_stamp.recipients",
+    "validation_stamp.signature",
+    "validation_stamp.protocol_version",
+    "cross_validation_stamps"
+  ]
+
+  @compression_dictionary @columns
+                          |> Enum.map(&<<byte_size(&1)::8, &1::binary>>)
+                          |> :erlang.list_to_binary()
+
   @doc """
   Encode a transaction
   """
@@ -169,6 +202,48 @@ defmodule Archethic.DB.EmbeddedImpl.Encoding do
     <<tx_size::32, tx_version::32, binary_encoding::binary>>
   end
 
+  @doc """
+  Compress the columns of an encoded transaction.
+
+  The compressed transaction keeps the same header, with its size being the compressed size and
+  the highest bit of the version flagging the compression, so a chain file can mix compressed and
+  raw transactions, still addressed by their offset and size.
+
+  ## Examples
+
+      iex> encoded = <<12::32, 1::32, 7::8, 2::32, "address", 0, 1>>
+      iex> <<_size::32, 1::1, 1::31, _::binary>> = compressed = Encoding.compress(encoded)
+      iex> <<_::64, columns::binary>> = compressed
+      iex> Encoding.decompress(columns)
+      <<7::8, 2::32, "address", 0, 1>>
+  """
+  @spec compress(binary()) :: binary()
+  def compress(<<_size::32, tx_version::32, columns::binary>>) do
+    z = :zlib.open()
+    :ok = :zlib.deflateInit(z, :best_speed, :deflated, -15, 8, :default)
+    _adler = :zlib.deflateSetDictionary(z, @compression_dictionary)
+    compressed = z |> :zlib.deflate(columns, :finish) |> :erlang.iolist_to_binary()
+    :zlib.deflateEnd(z)
+    :zlib.close(z)
+
+    <<byte_size(compressed)::32, 1::1, tx_version::31, compressed::binary>>
+  end
+
+  @doc """
+  Decompress the columns of a compressed transaction
+  """
+  @spec decompress(binary()) :: binary()
+  def decompress(compressed) do
+    z = :zlib.open()
+    :ok = :zlib.inflateInit(z, -15)
+    :ok = :zlib.inflateSetDictionary(z, @compression_dictionary)
+    columns = z |> :zlib.inflate(compressed) |> :erlang.iolist_to_binary()
+    :zlib.inflateEnd(z)
+    :zlib.close(z)
+
+    columns
+  end
+
   def decode(_version, "type", <<type::8>>, acc),
     do: Map.put(acc, :type, Transaction.parse_type(type))
 
@@ -18,6 +18,14 @@ defmodule Archethic.Election do
 
   alias Archethic.Utils
 
+  @typedoc """
+  Chain storage election of a set of nodes, shared by the checks of several addresses
+  """
+  @type chain_storage_election :: %{
+          required(:node_list) => list(Node.t()),
+          optional(atom()) => any()
+        }
+
   @doc """
   Create a seed to sort the validation nodes. This will produce a proof for the election
   """
@@ -284,42 +292,14 @@ defmodule Archethic.Election do
   def storage_nodes(_address, _nodes, constraints \\ StorageConstraints.new())
   def storage_nodes(_, [], _), do: []
 
-  def storage_nodes(
-        address,
-        nodes,
-        %StorageConstraints{
-          number_replicas: number_replicas_fun,
-          min_geo_patch_average_availability: min_geo_patch_avg_availability_fun,
-          min_geo_patch: min_geo_patch_fun
-        }
-      )
+  def storage_nodes(address, nodes, constraints = %StorageConstraints{})
       when is_binary(address) and is_list(nodes) do
     start = System.monotonic_time()
 
-    # Evaluate the storage election constraints
-
-    nb_replicas = number_replicas_fun.(nodes)
-    min_geo_patch_avg_availability = min_geo_patch_avg_availability_fun.()
-    min_geo_patch = min_geo_patch_fun.()
-
-    storage_nonce = Crypto.storage_nonce()
-
     storage_nodes =
       nodes
-      |> sort_nodes_by_key_rotation(address, storage_nonce, :first_public_key)
-      |> Enum.reduce_while(
-        %{
-          nb_nodes: 0,
-          zones: %{},
-          nodes: [],
-          nb_replicas: nb_replicas,
-          min_geo_patch: min_geo_patch,
-          min_geo_patch_avg_availability: min_geo_patch_avg_availability
-        },
-        &reduce_storage_nodes/2
-      )
-      |> Map.get(:nodes)
-      |> Enum.reverse()
+      |> storage_election(constraints)
+      |> elect_storage_nodes(address)
 
     :telemetry.execute(
       [:archethic, :election, :storage_nodes],
@@ -330,48 +310,85 @@ defmodule Archethic.Election do
     storage_nodes
   end
 
-  defp reduce_storage_nodes(
-         node = %Node{
-           geo_patch: geo_patch,
-           average_availability: avg_availability
-         },
-         acc
-       ) do
-    if storage_constraints_satisfied?(acc) do
-      {:halt, acc}
-    else
-      new_acc =
-        acc
-        |> Map.update!(:zones, fn zones ->
-          Map.update(
-            zones,
-            String.first(geo_patch),
-            avg_availability,
-            &(&1 + avg_availability)
-          )
+  # Evaluate the storage election constraints and extract the key of each node used
+  # by the rotation, so they can be shared by several addresses
+  defp storage_election(nodes, %StorageConstraints{
+         number_replicas: number_replicas_fun,
+         min_geo_patch_average_availability: min_geo_patch_avg_availability_fun,
+         min_geo_patch: min_geo_patch_fun
+       }) do
+    %{
+      nb_replicas: number_replicas_fun.(nodes),
+      min_geo_patch: min_geo_patch_fun.(),
+      min_geo_patch_avg_availability: min_geo_patch_avg_availability_fun.(),
+      storage_nonce: Crypto.storage_nonce(),
+      nodes:
+        Enum.map(nodes, fn node = %Node{first_public_key: <<_::8, _::8, public_key::binary>>} ->
+          {public_key, node}
         end)
-        |> Map.update!(:nb_nodes, &(&1 + 1))
-        |> Map.update!(:nodes, &[node | &1])
+    }
+  end
 
-      {:cont, new_acc}
-    end
+  defp elect_storage_nodes(election = %{nodes: nodes, storage_nonce: storage_nonce}, address) do
+    nodes
+    |> Enum.map(fn {public_key, node} ->
+      {:crypto.hash(:sha256, [public_key, address, storage_nonce]), node}
+    end)
+    |> List.keysort(0)
+    |> select_storage_nodes(election, 0, %{}, 0, [])
   end
 
-  defp storage_constraints_satisfied?(%{
-         min_geo_patch: min_geo_patch,
-         min_geo_patch_avg_availability: min_geo_patch_avg_availability,
-         nb_replicas: nb_replicas,
-         nb_nodes: nb_nodes,
-         zones: zones
-       }) do
-    if nb_nodes >= nb_replicas do
-      fullfilled_zones =
-        Enum.filter(zones, fn {_, avg} -> avg >= min_geo_patch_avg_availability end)
+  # Take the sorted nodes until the constraints are satisfied.
+  # The availabilities are positive, so once a zone reaches the minimum average availability
+  # it remains fulfilled and the fulfilled zones can be counted as the nodes are taken.
+  # The zone is only read from the nodes which are actually taken.
+  defp select_storage_nodes(
+         _sorted_nodes,
+         %{nb_replicas: nb_replicas, min_geo_patch: min_geo_patch},
+         nb_nodes,
+         _zones,
+         nb_fulfilled_zones,
+         acc
+       )
+       when nb_nodes >= nb_replicas and nb_fulfilled_zones >= min_geo_patch,
+       do: Enum.reverse(acc)
+
+  defp select_storage_nodes([], _election, _nb_nodes, _zones, _nb_fulfilled_zones, acc),
+    do: Enum.reverse(acc)
+
+  defp select_storage_nodes(
+         [{_, node = %Node{geo_patch: geo_patch, average_availability: avg_availability}} | rest],
+         election = %{min_geo_patch_avg_availability: min_geo_patch_avg_availability},
+         nb_nodes,
+         zones,
+         nb_fulfilled_zones,
+         acc
+       ) do
+    zone = String.first(geo_patch)
 
-      length(fullfilled_zones) >= min_geo_patch
-    else
-      false
-    end
+    {previous_availability, zone_availability} =
+      case Map.get(zones, zone) do
+        nil -> {nil, avg_availability}
+        availability -> {availability, availability + avg_availability}
+      end
+
+    nb_fulfilled_zones =
+      if zone_availability >= min_geo_patch_avg_availability and
+           (previous_availability == nil or
+              previous_availability < min_geo_patch_avg_availability) do
+        nb_fulfilled_zones + 1
+      else
+        nb_fulfilled_zones
+      end
+
+    select_storage_nodes(
+      rest,
+      election,
+      nb_nodes + 1,
+      Map.put(zones, zone, zone_availability),
+      nb_fulfilled_zones,
+      [node | acc]
+    )
   end
 
   # Provide an unpredictable and reproducible list of allowed nodes using a rotating key algorithm
@@ -382,12 +399,12 @@ defmodule Archethic.Election do
   # This rotated key acts as sort mechanism to produce a fair node election
   defp sort_nodes_by_key_rotation(nodes, hash, sorting_seed, key_to_use) do
     nodes
-    |> Stream.map(fn node ->
+    |> Enum.map(fn node ->
       <<_::8, _::8, public_key::binary>> = Map.get(node, key_to_use)
       rotated_key = :crypto.hash(:sha256, [public_key, hash, sorting_seed])
       {rotated_key, node}
     end)
-    |> Enum.sort_by(fn {rotated_key, _} -> rotated_key end)
+    |> List.keysort(0)
     |> Enum.map(fn {_, n} -> n end)
   end
 
@@ -627,10 +644,16 @@ defmodule Archethic.Election do
         movements_addresses,
         nodes,
         storage_constraints \\ StorageConstraints.new()
-      ) do
+      )
+
+  def io_storage_nodes([], _nodes, _storage_constraints), do: []
+  def io_storage_nodes(_movements_addresses, [], _storage_constraints), do: []
+
+  def io_storage_nodes(movements_addresses, nodes, storage_constraints) do
+    election = storage_election(nodes, storage_constraints)
+
     movements_addresses
-    |> Stream.map(&storage_nodes(&1, nodes, storage_constraints))
-    |> Stream.flat_map(& &1)
+    |> Stream.flat_map(&elect_storage_nodes(election, &1))
     |> Enum.uniq_by(& &1.first_public_key)
   end
 
@@ -662,7 +685,7 @@ defmodule Archethic.Election do
           binary(),
           Transaction.transaction_type(),
           Crypto.key(),
-          list(Node.t())
+          list(Node.t()) | chain_storage_election()
         ) :: boolean()
   def chain_storage_node?(
         address,
@@ -670,7 +693,8 @@ defmodule Archethic.Election do
         public_key,
         node_list
       )
-      when is_binary(address) and is_atom(type) and is_binary(public_key) and is_list(node_list) do
+      when is_binary(address) and is_atom(type) and is_binary(public_key) and
+             (is_list(node_list) or is_map(node_list)) do
     address
     |> chain_storage_nodes_with_type(type, node_list)
     |> Utils.key_in_node_list?(public_key)
@@ -679,7 +703,8 @@ defmodule Archethic.Election do
   @doc """
   Determine if a node's public key must be a chain storage node
   """
-  @spec chain_storage_node?(binary, Crypto.key(), list(Node.t())) :: boolean()
+  @spec chain_storage_node?(binary, Crypto.key(), list(Node.t()) | chain_storage_election()) ::
+          boolean()
   def chain_storage_node?(address, public_key, node_list) do
     address
     |> chain_storage_nodes(node_list)
@@ -730,7 +755,7 @@ defmodule Archethic.Election do
   @spec chain_storage_nodes_with_type(
           binary(),
           Transaction.transaction_type(),
-          list(Node.t())
+          list(Node.t()) | chain_storage_election()
         ) ::
           list(Node.t())
   def chain_storage_nodes_with_type(
@@ -746,10 +771,21 @@ defmodule Archethic.Election do
     end
   end
 
+  def chain_storage_nodes_with_type(address, type, election = %{node_list: node_list})
+      when is_binary(address) and is_atom(type) do
+    if Transaction.network_type?(type) do
+      node_list
+    else
+      chain_storage_nodes(address, election)
+    end
+  end
+
   @doc """
   Return the storage nodes for the transaction chain based on the transaction address and set a nodes
+  or a chain storage election built with `chain_storage_election/1`
   """
-  @spec chain_storage_nodes(binary(), list(Node.t())) :: list(Node.t())
+  @spec chain_storage_nodes(binary(), list(Node.t()) | chain_storage_election()) ::
+          list(Node.t())
   def chain_storage_nodes(address, node_list)
       when is_binary(address) and is_list(node_list) do
     storage_nodes(
@@ -759,6 +795,27 @@ defmodule Archethic.Election do
     )
   end
 
+  def chain_storage_nodes(address, %{node_list: []}) when is_binary(address), do: []
+
+  def chain_storage_nodes(address, election = %{node_list: _}) when is_binary(address),
+    do: elect_storage_nodes(election, address)
+
+  @doc """
+  Prepare the chain storage election of a set of nodes, to be shared by the checks
+  of several addresses (`chain_storage_nodes/2`, `chain_storage_node?/3,4`).
+
+  The storage constraints, the storage nonce and the nodes' keys are evaluated once
+  instead of once per address.
+  """
+  @spec chain_storage_election(list(Node.t())) :: chain_storage_election()
+  def chain_storage_election([]), do: %{node_list: []}
+
+  def chain_storage_election(node_list) when is_list(node_list) do
+    node_list
+    |> storage_election(get_storage_constraints())
+    |> Map.put(:node_list, node_list)
+  end
+
   @doc """
 
   Get the synchronized and available nodes at before the given time
@@ -112,11 +112,20 @@ defmodule Archethic.Election.HypergeometricDistribution do
 
   defp start_simulation_task(nb_nodes) do
     Task.async(fn ->
+      # The executable runs a single simulation, so its lifetime is the native service time
+      start = System.monotonic_time()
       pid = Port.open({:spawn_executable, executable()}, args: [Integer.to_string(nb_nodes)])
 
       receive do
         {^pid, {:data, data}} ->
           {result, _} = :string.to_integer(data)
+
+          :telemetry.execute(
+            [:archethic, :election, :hypergeometric_distribution],
+            %{duration: System.monotonic_time() - start},
+            %{nb_nodes: nb_nodes}
+          )
+
           {nb_nodes, result}
       end
     end)
@@ -88,7 +88,14 @@ defmodule Archethic.P2P.Message.ReplicateTransaction do
       end
     end)
     |> Enum.uniq()
-    |> Enum.any?(&Election.chain_storage_node?(&1, node_public_key, authorized_nodes))
+    |> then(fn
+      [] ->
+        false
+
+      addresses ->
+        storage_election = Election.chain_storage_election(authorized_nodes)
+        Enum.any?(addresses, &Election.chain_storage_node?(&1, node_public_key, storage_election))
+    end)
   end
 
   @spec serialize(t()) :: bitstring()
@@ -200,9 +200,14 @@ defmodule Archethic.Replication do
          download_nodes,
          genesis_address
        ) do
-    Transaction.network_type?(type) or
-      Election.chain_storage_node?(address, first_node_key, download_nodes) or
-      Election.chain_storage_node?(genesis_address, first_node_key, download_nodes)
+    if Transaction.network_type?(type) do
+      true
+    else
+      storage_election = Election.chain_storage_election(download_nodes)
+
+      Election.chain_storage_node?(address, first_node_key, storage_election) or
+        Election.chain_storage_node?(genesis_address, first_node_key, storage_election)
+    end
   end
 
   @doc """
@@ -352,12 +352,17 @@ defmodule Archethic.SelfRepair.Sync do
           replication_attestations :: list(ReplicationAttestation.t()),
           download_nodes :: list(Node.t())
         ) :: integer()
+  def process_replication_attestations([], _download_nodes), do: 0
+
   def process_replication_attestations(replication_attestations, download_nodes) do
     nodes_including_self = [P2P.get_node_info() | download_nodes] |> P2P.distinct_nodes()
+    storage_election = Election.chain_storage_election(nodes_including_self)
 
     replication_attestations
     |> adjust_attestations(download_nodes)
-    |> Stream.filter(&TransactionHandler.download_transaction?(&1, nodes_including_self))
+    |> Stream.filter(
+      &TransactionHandler.download_transaction?(&1, nodes_including_self, storage_election)
+    )
     |> Enum.sort_by(& &1.transaction_summary.timestamp, {:asc, DateTime})
     |> then(fn filtered_attestations ->
       synchronize_transactions(filtered_attestations, download_nodes)
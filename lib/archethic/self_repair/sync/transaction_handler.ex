@@ -31,8 +31,16 @@ defmodule Archethic.SelfRepair.Sync.TransactionHandler do
 
   Verify firstly the chain storage nodes election.
   If not successful, perform storage nodes election based on the transaction movements.
+
+  The chain storage election of the nodes can be given to be shared among several attestations.
   """
-  @spec download_transaction?(ReplicationAttestation.t(), list(Node.t())) :: boolean()
+  @spec download_transaction?(
+          ReplicationAttestation.t(),
+          list(Node.t()),
+          Election.chain_storage_election() | nil
+        ) :: boolean()
+  def download_transaction?(attestation, node_list, storage_election \\ nil)
+
   def download_transaction?(
         %ReplicationAttestation{
           transaction_summary: %TransactionSummary{
@@ -40,6 +48,7 @@ defmodule Archethic.SelfRepair.Sync.TransactionHandler do
             version: 1
           }
         },
+        _,
         _
       ),
       do: not TransactionChain.transaction_exists?(address)
@@ -53,12 +62,14 @@ defmodule Archethic.SelfRepair.Sync.TransactionHandler do
             movements_addresses: movements_addresses
           }
         },
-        node_list
+        node_list,
+        storage_election
       ) do
     node_key = Crypto.first_node_public_key()
+    storage_election = storage_election || Election.chain_storage_election(node_list)
 
-    if Election.chain_storage_node?(address, type, node_key, node_list) or
-         Election.chain_storage_node?(genesis_address, node_key, node_list) do
+    if Election.chain_storage_node?(address, type, node_key, storage_election) or
+         Election.chain_storage_node?(genesis_address, node_key, storage_election) do
       not TransactionChain.transaction_exists?(address)
     else
       io_node?(movements_addresses, node_key, node_list) and
@@ -183,9 +194,10 @@ defmodule Archethic.SelfRepair.Sync.TransactionHandler do
     resolved_addresses = get_resolved_addresses(attestation)
 
     node_list = [P2P.get_node_info() | node_list] |> P2P.distinct_nodes()
+    storage_election = Election.chain_storage_election(node_list)
 
     cond do
-      Election.chain_storage_node?(address, type, node_key, node_list) ->
+      Election.chain_storage_node?(address, type, node_key, storage_election) ->
         Replication.sync_transaction_chain(tx, genesis_address, node_list,
           self_repair?: true,
           resolved_addresses: resolved_addresses
@@ -193,7 +205,7 @@ defmodule Archethic.SelfRepair.Sync.TransactionHandler do
 
         TransactionChain.write_inputs(address, inputs)
 
-      Election.chain_storage_node?(genesis_address, node_key, node_list) ->
+      Election.chain_storage_node?(genesis_address, node_key, storage_election) ->
         Replication.sync_transaction_chain(tx, genesis_address, node_list,
           self_repair?: true,
           resolved_addresses: resolved_addresses
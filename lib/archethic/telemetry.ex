@@ -19,7 +19,10 @@ defmodule Archethic.Telemetry do
   defp periodic_metrics do
     [
       {Archethic.Contracts, :maximum_calls_in_queue, []},
-      {Archethic.P2P, :nodes_connected_count, []}
+      {Archethic.P2P, :nodes_connected_count, []},
+      {Archethic.Crypto.Ed25519.LibSodiumPort, :emit_stats, []},
+      {Archethic.Crypto.NodeKeystore.Origin.TPMImpl, :emit_stats, []},
+      {Archethic.DB.EmbeddedImpl.ChainIndex, :emit_stats, []}
     ]
   end
 
@@ -53,6 +56,14 @@ defmodule Archethic.Telemetry do
           buckets: [10, 30, 50, 100, 200, 500, 1000, 2000]
         ]
       ),
+      distribution("archethic.election.hypergeometric_distribution.duration",
+        unit: {:native, :millisecond},
+        tags: [:nb_nodes],
+        measurement: :duration,
+        reporter_options: [
+          buckets: [10, 30, 50, 100, 200, 500, 1000, 2000, 5000, 10000]
+        ]
+      ),
       distribution("archethic.election.storage_nodes.duration",
         unit: {:native, :millisecond},
         tags: [:nb_nodes],
@@ -149,6 +160,7 @@ defmodule Archethic.Telemetry do
           buckets: [10, 50, 100, 200, 300, 500, 700, 900, 1000, 1500, 2000, 3000]
         ]
       ),
+      last_value("archethic.crypto.ephemeral_key_pool.depth"),
       distribution("archethic.crypto.libsodium.duration",
         unit: {:native, :millisecond},
         reporter_options: [buckets: [10, 30, 50, 100, 200, 500, 1000, 2000, 5000]],
@@ -262,6 +274,38 @@ defmodule Archethic.Telemetry do
       counter("archethic_web.hosting.cache_file.miss.count"),
       counter("archethic_web.hosting.cache_ref_tx.hit.count"),
       counter("archethic_web.hosting.cache_ref_tx.miss.count")
+    ] ++ native_port_metrics()
+  end
+
+  # Histograms recorded by the native ports are cumulative since the port started
+  defp native_port_metrics do
+    histogram_metrics =
+      for kind <- [:queue_time, :service_time], stat <- [:p50, :p99, :p999, :max] do
+        last_value("archethic.native_port.#{kind}.#{stat}",
+          unit: {:nanosecond, :microsecond},
+          tags: [:port, :function]
+        )
+      end
+
+    # Only emitted when the port handlers are started with tracing
+    trace_metrics =
+      for stage <- [
+            :duration,
+            :mailbox_time,
+            :native_queue_time,
+            :native_service_time,
+            :pipe_time
+          ] do
+        distribution("archethic.port_handler.request.stop.#{stage}",
+          unit: {:native, :microsecond},
+          reporter_options: [buckets: [10, 50, 100, 250, 500, 1000, 5000, 10000, 50000, 100_000]],
+          tags: [:program, :function]
+        )
+      end
+
+    [
+      last_value("archethic.native_port.service_time.count", tags: [:port, :function])
+      | histogram_metrics ++ trace_metrics
     ]
   end
 end
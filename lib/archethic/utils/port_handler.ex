@@ -4,78 +4,381 @@ defmodule Archethic.Utils.PortHandler do
   use GenServer
   @vsn 1
 
+  require Logger
+
+  # Function id reserved by the native ports to report their latency histograms
+  @stats_fun_id 255
+
+  # The highest bit of the 32 bits request id is used as trace flag
+  @max_request_id 0x7FFFFFFF
+
+  # Coalesced requests are written without waiting for the window once they reach this size
+  @max_coalesced_size 65_536
+
+  @type histogram :: %{
+          count: non_neg_integer(),
+          sum: non_neg_integer(),
+          max: non_neg_integer(),
+          buckets: list({lower_bound :: non_neg_integer(), count :: non_neg_integer()})
+        }
+
+  @doc """
+  Start the port handler for the given `:program`.
+
+  When `:trace` is enabled (default from the `:archethic, Archethic.Utils.PortHandler` config),
+  each request asks the port to echo its native timestamps and a telemetry span
+  `[:archethic, :port_handler, :request]` is emitted with the time spent in each stage:
+  - `mailbox_time`: waiting in the port handler's mailbox
+  - `native_queue_time`: waiting in the port before being processed
+  - `native_service_time`: processed by the port
+  - `pipe_time`: remaining time spent in the pipes and the port's reading/writing
+
+  The requests received within the `:coalesce_window` (in milliseconds, default from the
+  config) are written to the port at once. With a window of 0, only the requests already
+  waiting in the mailbox are coalesced, and with `nil` each request is written on its own.
+  The framing stays the same (4 bytes length, request id, function id, data), so the port
+  sees the same requests, and it answers the requests received together in a single write.
+  """
   def start_link(args \\ [], opts \\ []) do
     GenServer.start_link(__MODULE__, args, opts)
   end
 
   def init(args) do
     program = Keyword.fetch!(args, :program)
-    port = Port.open({:spawn_executable, program}, [:binary, :exit_status, {:packet, 4}])
 
-    {:ok, %{port: port, next_id: 1, awaiting: %{}}}
+    trace? =
+      Keyword.get_lazy(args, :trace, fn ->
+        :archethic |> Application.get_env(__MODULE__, []) |> Keyword.get(:trace, false)
+      end)
+
+    coalesce_window =
+      Keyword.get_lazy(args, :coalesce_window, fn ->
+        :archethic |> Application.get_env(__MODULE__, []) |> Keyword.get(:coalesce_window, 0)
+      end)
+
+    # The frames are length prefixed here rather than with the `:packet` option, so several
+    # requests can be written with a single command and several responses read at once
+    port = Port.open({:spawn_executable, program}, [:binary, :exit_status])
+
+    {:ok,
+     %{
+       port: port,
+       program: Path.basename(program),
+       trace?: trace?,
+       next_id: 1,
+       awaiting: %{},
+       coalesce_window: coalesce_window,
+       pending_requests: [],
+       pending_size: 0,
+       flush_scheduled?: false,
+       buffer: <<>>
+     }}
   end
 
   @doc """
   Send a request to the port
   """
-  @spec request(pid(), request_id :: non_neg_integer(), data :: binary()) ::
+  @spec request(pid(), request_id :: non_neg_integer(), data :: binary(), timeout()) ::
           {:ok, binary()} | :ok | {:error, binary()}
-  def request(port_handler, request_id, data) when is_integer(request_id) and is_binary(data) do
-    GenServer.call(port_handler, {:rpc, request_id, data})
+  def request(port_handler, request_id, data, timeout \\ 5_000)
+      when is_integer(request_id) and is_binary(data) do
+    GenServer.call(port_handler, {:rpc, request_id, data, System.monotonic_time()}, timeout)
   end
 
-  def handle_call({:rpc, request_id, data}, from, state = %{next_id: id, port: port}) do
-    send_request(id, port, request_id, data)
+  @doc """
+  Send a request to the port without waiting for its response.
 
-    next_state =
-      state
-      |> Map.update!(:next_id, &(&1 + 1))
-      |> Map.update!(:awaiting, &Map.put(&1, id, from))
+  An error returned by the port is logged
+  """
+  @spec cast(pid(), request_id :: non_neg_integer(), data :: binary()) :: :ok
+  def cast(port_handler, request_id, data) when is_integer(request_id) and is_binary(data) do
+    GenServer.cast(port_handler, {:rpc, request_id, data, System.monotonic_time()})
+  end
+
+  @doc """
+  Fetch the latency histograms (in nanoseconds) recorded natively by the port for each
+  function id.
 
-    {:noreply, next_state}
+  The queue time is the time spent between the reception of the request and the start of its
+  processing, the service time is the time spent processing it.
+  """
+  @spec stats(pid()) ::
+          {:ok,
+           %{
+             non_neg_integer() => %{
+               optional(:queue_time) => histogram(),
+               optional(:service_time) => histogram()
+             }
+           }}
+          | {:error, binary()}
+  def stats(port_handler) do
+    case request(port_handler, @stats_fun_id, <<>>) do
+      {:ok, data} -> {:ok, decode_stats(data, %{})}
+      :ok -> {:ok, %{}}
+      {:error, _} = e -> e
+    end
   end
 
-  def handle_call({:rpc, request_id}, from, state = %{next_id: id, port: port}) do
-    send_request(id, port, request_id)
+  @doc """
+  Emit telemetry events for the native latency histograms of the port.
 
-    next_state =
-      state
-      |> Map.update!(:next_id, &(&1 + 1))
-      |> Map.update!(:awaiting, &Map.put(&1, id, from))
+  The function ids are replaced by their names when present in `function_names`
+  """
+  @spec emit_stats(
+          pid(),
+          port_name :: atom(),
+          function_names :: %{non_neg_integer() => atom()}
+        ) :: :ok
+  def emit_stats(port_handler, port_name, function_names \\ %{}) do
+    case stats(port_handler) do
+      {:ok, stats} -> do_emit_stats(stats, port_name, function_names)
+      {:error, _} -> :ok
+    end
+  catch
+    # The poller must survive a busy or restarting port
+    :exit, _ -> :ok
+  end
+
+  defp do_emit_stats(stats, port_name, function_names) do
+    Enum.each(stats, fn {fun_id, histograms} ->
+      metadata = %{port: port_name, function: Map.get(function_names, fun_id, fun_id)}
+
+      Enum.each(histograms, fn {kind, histogram} ->
+        :telemetry.execute(
+          [:archethic, :native_port, kind],
+          %{
+            count: histogram.count,
+            max: histogram.max,
+            p50: percentile(histogram, 0.5),
+            p99: percentile(histogram, 0.99),
+            p999: percentile(histogram, 0.999)
+          },
+          metadata
+        )
+      end)
+    end)
+  end
+
+  @doc """
+  Return the lower bound of the bucket holding the given percentile of the histogram
+
+  ## Examples
+
+      iex> PortHandler.percentile(%{count: 4, buckets: [{10, 2}, {20, 1}, {30, 1}]}, 0.5)
+      10
+
+      iex> PortHandler.percentile(%{count: 4, buckets: [{10, 2}, {20, 1}, {30, 1}]}, 0.99)
+      30
+
+      iex> PortHandler.percentile(%{count: 0, buckets: []}, 0.99)
+      0
+  """
+  @spec percentile(%{count: non_neg_integer(), buckets: list()}, float()) :: non_neg_integer()
+  def percentile(%{count: 0}, _), do: 0
+
+  def percentile(%{count: count, buckets: buckets}, percentile) do
+    rank = max(1, ceil(count * percentile))
+
+    Enum.reduce_while(buckets, 0, fn {lower_bound, bucket_count}, acc ->
+      if acc + bucket_count >= rank,
+        do: {:halt, lower_bound},
+        else: {:cont, acc + bucket_count}
+    end)
+  end
+
+  defp decode_stats(<<>>, acc), do: acc
+
+  defp decode_stats(
+         <<fun_id::8, kind::8, count::64, sum::64, max::64, nb_buckets::16,
+           buckets::binary-size(nb_buckets * 16), rest::binary>>,
+         acc
+       ) do
+    buckets =
+      for <<lower_bound::64, bucket_count::64 <- buckets>>, do: {lower_bound, bucket_count}
+
+    histogram = %{count: count, sum: sum, max: max, buckets: buckets}
+
+    kind = if kind == 0, do: :queue_time, else: :service_time
+    acc = Map.update(acc, fun_id, %{kind => histogram}, &Map.put(&1, kind, histogram))
+
+    decode_stats(rest, acc)
+  end
+
+  def handle_call({:rpc, request_id, data, enqueued_at}, from, state) do
+    {:noreply, do_request(request_id, data, from, enqueued_at, state)}
+  end
 
-    {:noreply, next_state}
+  def handle_call({:rpc, request_id, data}, from, state) do
+    {:noreply, do_request(request_id, data, from, System.monotonic_time(), state)}
   end
 
-  def handle_info(
-        {_port, {:data, <<request_id::32, response::binary>>}},
-        state = %{awaiting: awaiting}
-      ) do
+  def handle_call({:rpc, request_id}, from, state) do
+    {:noreply, do_request(request_id, "", from, System.monotonic_time(), state)}
+  end
+
+  def handle_cast({:rpc, request_id, data, enqueued_at}, state) do
+    {:noreply, do_request(request_id, data, nil, enqueued_at, state)}
+  end
+
+  def handle_info({port, {:data, data}}, state = %{port: port, buffer: buffer}) do
+    buffer = if buffer == <<>>, do: data, else: <<buffer::binary, data::binary>>
+    {:noreply, handle_responses(buffer, state)}
+  end
+
+  def handle_info(:flush_requests, state) do
+    {:noreply, flush_requests(%{state | flush_scheduled?: false})}
+  end
+
+  def handle_info({_port, {:exit_status, status}}, state) do
+    :erlang.error({:port_exit, status})
+    {:noreply, state}
+  end
+
+  defp do_request(
+         request_id,
+         data,
+         from,
+         enqueued_at,
+         state = %{next_id: id, trace?: trace?, program: program}
+       ) do
+    dequeued_at = System.monotonic_time()
+    state = send_request(id, request_id, data, state)
+
+    trace =
+      if trace? do
+        :telemetry.execute(
+          [:archethic, :port_handler, :request, :start],
+          %{system_time: System.system_time(), monotonic_time: enqueued_at},
+          %{program: program, function: request_id}
+        )
+
+        %{function: request_id, enqueued_at: enqueued_at, dequeued_at: dequeued_at}
+      end
+
+    state
+    |> Map.put(:next_id, if(id == @max_request_id, do: 1, else: id + 1))
+    |> Map.update!(:awaiting, &Map.put(&1, id, {from, trace}))
+  end
+
+  defp handle_responses(<<size::32, response::binary-size(size), rest::binary>>, state) do
+    handle_responses(rest, handle_response(response, state))
+  end
+
+  defp handle_responses(buffer, state), do: %{state | buffer: buffer}
+
+  defp handle_response(
+         <<trace_flag::1, request_id::31, response::binary>>,
+         state = %{awaiting: awaiting, program: program}
+       ) do
+    {response, native_times} = extract_native_times(trace_flag, response)
+
     case Map.pop(awaiting, request_id) do
       {nil, awaiting} ->
-        {:noreply, %{state | awaiting: awaiting}}
+        %{state | awaiting: awaiting}
 
-      {client, awaiting} ->
+      {{client, trace}, awaiting} ->
         case response do
           <<0::8, error_message::binary>> ->
-            GenServer.reply(client, {:error, error_message})
+            reply(client, {:error, error_message}, program)
 
           <<1::8>> ->
-            GenServer.reply(client, :ok)
+            reply(client, :ok, program)
 
           <<1::8, data::binary>> ->
-            GenServer.reply(client, {:ok, data})
+            reply(client, {:ok, data}, program)
         end
 
-        {:noreply, %{state | awaiting: awaiting}}
+        emit_trace(trace, native_times, program)
+
+        %{state | awaiting: awaiting}
     end
   end
 
-  def handle_info({_port, {:exit_status, status}}, state) do
-    :erlang.error({:port_exit, status})
-    {:noreply, state}
+  # The requests sent with cast/3 have no client to reply to
+  defp reply(nil, {:error, error_message}, program) do
+    Logger.warning("Port request failed: #{error_message}", program: program)
+  end
+
+  defp reply(nil, _, _), do: :ok
+  defp reply(client, response, _), do: GenServer.reply(client, response)
+
+  defp extract_native_times(1, response) do
+    <<received_at::64, started_at::64, finished_at::64, rest::binary>> = response
+    {rest, {received_at, started_at, finished_at}}
+  end
+
+  defp extract_native_times(0, response), do: {response, nil}
+
+  defp emit_trace(nil, _, _), do: :ok
+
+  defp emit_trace(
+         %{function: function, enqueued_at: enqueued_at, dequeued_at: dequeued_at},
+         {received_at, started_at, finished_at},
+         program
+       ) do
+    now = System.monotonic_time()
+
+    # Native timestamps come from another clock, only their differences are meaningful
+    native_time = &System.convert_time_unit(&1, :nanosecond, :native)
+
+    :telemetry.execute(
+      [:archethic, :port_handler, :request, :stop],
+      %{
+        monotonic_time: now,
+        duration: now - enqueued_at,
+        mailbox_time: dequeued_at - enqueued_at,
+        native_queue_time: native_time.(started_at - received_at),
+        native_service_time: native_time.(finished_at - started_at),
+        pipe_time: now - dequeued_at - native_time.(finished_at - received_at)
+      },
+      %{program: program, function: function}
+    )
   end
 
-  defp send_request(id, port, request_id, data \\ "") do
-    Port.command(port, <<id::32, request_id::8, data::binary>>)
+  defp send_request(
+         id,
+         request_id,
+         data,
+         state = %{
+           trace?: trace?,
+           coalesce_window: coalesce_window,
+           pending_requests: pending_requests,
+           pending_size: pending_size,
+           flush_scheduled?: flush_scheduled?
+         }
+       ) do
+    trace_flag = if trace?, do: 1, else: 0
+    size = byte_size(data) + 5
+    request = [<<size::32, trace_flag::1, id::31, request_id::8>>, data]
+
+    state = %{
+      state
+      | pending_requests: [request | pending_requests],
+        pending_size: pending_size + size + 4
+    }
+
+    cond do
+      coalesce_window == nil or state.pending_size >= @max_coalesced_size ->
+        flush_requests(state)
+
+      flush_scheduled? ->
+        state
+
+      coalesce_window == 0 ->
+        # Handled after the requests already in the mailbox
+        send(self(), :flush_requests)
+        %{state | flush_scheduled?: true}
+
+      true ->
+        Process.send_after(self(), :flush_requests, coalesce_window)
+        %{state | flush_scheduled?: true}
+    end
+  end
+
+  defp flush_requests(state = %{pending_requests: []}), do: state
+
+  defp flush_requests(state = %{port: port, pending_requests: pending_requests}) do
+    Port.command(port, Enum.reverse(pending_requests))
+    %{state | pending_requests: [], pending_size: 0}
   end
 end
@@ -12,9 +12,10 @@ defmodule Archethic.Utils.Regression do
   alias Archethic.Utils.WebClient
   alias Archethic.Utils.Regression.Benchmark.EndToEndValidation
   alias Archethic.Utils.Regression.Benchmark.P2PMessage
+  alias Archethic.Utils.Regression.Benchmark.PortHandler
 
   @playbooks [UCO, SmartContract]
-  @benchmarks [P2PMessage, EndToEndValidation]
+  @benchmarks [P2PMessage, EndToEndValidation, PortHandler]
 
   def run_playbooks(nodes, opts \\ []) do
     Logger.debug("Running playbooks on #{inspect(nodes)} with #{inspect(opts)}")
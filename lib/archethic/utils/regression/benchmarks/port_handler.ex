@@ -0,0 +1,46 @@
+defmodule Archethic.Utils.Regression.Benchmark.PortHandler do
+  @moduledoc """
+  Benchmark the coalescing window of the native port requests: the throughput of concurrent
+  requests (ips * parallel) against the latency added to each request.
+
+  It runs locally against the libsodium port, whatever the testnet nodes
+  """
+
+  alias Archethic.Utils.PortHandler
+  alias Archethic.Utils.Regression.Benchmark
+
+  @behaviour Benchmark
+
+  # Coalescing windows in milliseconds, nil writes each request on its own
+  @windows [nil, 0, 1, 2]
+
+  def plan(_nodes, opts) do
+    program = Application.app_dir(:archethic, "/priv/c_dist/libsodium_port")
+
+    # Ed25519 base point, a valid public key to convert
+    public_key = <<0x58, :binary.copy(<<0x66>>, 31)::binary>>
+
+    # Each scenario runs against its own port, started before and stopped after it
+    scenarios =
+      Map.new(@windows, fn window ->
+        {"Convert public key (coalesce window: #{inspect(window)})",
+         {
+           fn port_handler -> {:ok, _} = PortHandler.request(port_handler, 1, public_key) end,
+           before_scenario: fn _ ->
+             {:ok, port_handler} =
+               PortHandler.start_link(program: program, coalesce_window: window)
+
+             port_handler
+           end,
+           after_scenario: &GenServer.stop/1
+         }}
+      end)
+
+    {scenarios,
+     [
+       parallel: Keyword.get(opts, :parallel, 64),
+       time: 10,
+       percentiles: [50, 99, 99.9]
+     ]}
+  end
+end
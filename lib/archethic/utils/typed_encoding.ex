@@ -54,19 +54,19 @@ defmodule Archethic.Utils.TypedEncoding do
     size = length(list)
     size_bin = VarInt.from_value(size)
 
-    Enum.reduce(list, <<@type_list::8, size_bin::binary>>, fn item, acc ->
-      <<acc::bitstring, do_serialize(item, bit_size)::bitstring>>
-    end)
+    # Items are gathered in an iolist and the bitstring is built once
+    items = Enum.map(list, &do_serialize(&1, bit_size))
+    :erlang.list_to_bitstring([<<@type_list::8, size_bin::binary>> | items])
   end
 
   defp do_serialize(map, bit_size) when is_map(map) do
     size = map_size(map)
     size_bin = VarInt.from_value(size)
 
-    Enum.reduce(map, <<@type_map::8, size_bin::binary>>, fn {k, v}, acc ->
-      <<acc::bitstring, do_serialize(k, bit_size)::bitstring,
-        do_serialize(v, bit_size)::bitstring>>
-    end)
+    entries =
+      Enum.map(map, fn {k, v} -> [do_serialize(k, bit_size), do_serialize(v, bit_size)] end)
+
+    :erlang.list_to_bitstring([<<@type_map::8, size_bin::binary>> | entries])
   end
 
   defp do_serialize(bool, bit_size) when is_boolean(bool) do
@@ -108,38 +108,13 @@ defmodule Archethic.Utils.TypedEncoding do
 
   defp do_deserialize(<<@type_list::8, rest::bitstring>>, bit_size) do
     {size, rest} = VarInt.get_value(rest)
-
-    case size do
-      0 ->
-        {[], rest}
-
-      _ ->
-        {list, rest} =
-          Enum.reduce(1..size, {[], rest}, fn _i, {list_acc, rest_acc} ->
-            {item, rest_acc} = do_deserialize(rest_acc, bit_size)
-
-            {[item | list_acc], rest_acc}
-          end)
-
-        {Enum.reverse(list), rest}
-    end
+    deserialize_list(rest, size, bit_size, [])
   end
 
   defp do_deserialize(<<@type_map::8, rest::bitstring>>, bit_size) do
     {size, rest} = VarInt.get_value(rest)
-
-    case size do
-      0 ->
-        {%{}, rest}
-
-      _ ->
-        Enum.reduce(1..size, {%{}, rest}, fn _i, {map_acc, rest_acc} ->
-          {key, rest_acc} = do_deserialize(rest_acc, bit_size)
-          {value, rest_acc} = do_deserialize(rest_acc, bit_size)
-
-          {Map.put(map_acc, key, value), rest_acc}
-        end)
-    end
+    {entries, rest} = deserialize_map_entries(rest, size, bit_size, [])
+    {:maps.from_list(entries), rest}
   end
 
   defp do_deserialize(<<@type_bool::8, rest::bitstring>>, bit_size) do
@@ -150,6 +125,22 @@ defmodule Archethic.Utils.TypedEncoding do
 
   defp do_deserialize(<<@type_nil::8, rest::bitstring>>, _bit_size), do: {nil, rest}
 
+  defp deserialize_list(rest, 0, _bit_size, acc), do: {Enum.reverse(acc), rest}
+
+  defp deserialize_list(rest, n, bit_size, acc) do
+    {item, rest} = do_deserialize(rest, bit_size)
+    deserialize_list(rest, n - 1, bit_size, [item | acc])
+  end
+
+  # Entries are kept in the encoding order so a duplicated key keeps its last value
+  defp deserialize_map_entries(rest, 0, _bit_size, acc), do: {Enum.reverse(acc), rest}
+
+  defp deserialize_map_entries(rest, n, bit_size, acc) do
+    {key, rest} = do_deserialize(rest, bit_size)
+    {value, rest} = do_deserialize(rest, bit_size)
+    deserialize_map_entries(rest, n - 1, bit_size, [{key, value} | acc])
+  end
+
   defp bit_to_sign(0), do: -1
   defp bit_to_sign(1), do: 1
 end
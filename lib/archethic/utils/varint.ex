@@ -3,29 +3,41 @@ defmodule Archethic.Utils.VarInt do
     VarInt is a Module for support of multi-byte length integers
   """
 
+  @doc """
+  Encode an integer with the minimum number of bytes required to store it
+
+  ## Examples
+
+      iex> VarInt.from_value(0)
+      <<1, 0>>
+
+      iex> VarInt.from_value(255)
+      <<1, 255>>
+
+      iex> VarInt.from_value(256)
+      <<2, 1, 0>>
+  """
   @spec from_value(integer()) :: bitstring()
-  def from_value(value) do
-    bytes = value |> min_bytes_to_store()
-    <<bytes::8, value::bytes*8>>
+  def from_value(value) when value >= 0 do
+    # :binary.encode_unsigned/1 is a BIF which returns the big-endian representation
+    # with the minimum number of bytes (one byte for 0)
+    case :binary.encode_unsigned(value) do
+      bin when byte_size(bin) <= 255 -> <<byte_size(bin)::8, bin::binary>>
+    end
   end
 
-  @spec min_bytes_to_store(integer()) :: integer()
-  defp min_bytes_to_store(value) do
-    # Since values go from
-    # 1*8 => 2^8 => 255 ~BYTES=1
-    # 2*8 => 16 => 2^16 => 65535 ~BYTES=2
-    # 3*8 => 24 => 2^24 => 16777215 ~BYTES=3
-    1..255 |> Enum.find(fn x -> value < Integer.pow(2, 8 * x) end)
-  end
+  def from_value(value), do: <<1::8, value::8>>
+
+  @doc """
+  Decode an integer encoded with `from_value/1` and return the rest of the data
 
+  ## Examples
+
+      iex> VarInt.get_value(<<2, 1, 0, 42>>)
+      {256, <<42>>}
+  """
   @spec get_value(bitstring()) :: {integer(), bitstring()}
-  def get_value(data) do
-    <<bytes::8, rest::bitstring>> = data
-    <<value::bytes*8, rest::bitstring>> = rest
-
-    {
-      value,
-      rest
-    }
+  def get_value(<<bytes::8, value::unsigned-size(bytes)-unit(8), rest::bitstring>>) do
+    {value, rest}
   end
 end
@@ -103,13 +103,15 @@ defmodule Archethic.UTXO do
          authorized_nodes,
          skip_verify_consumed?
        ) do
+    storage_election = Election.chain_storage_election(authorized_nodes)
+
     utxos_by_genesis =
       transaction_movements
       |> consolidate_movements(protocol_version, tx_type)
       |> Enum.reduce(%{}, fn %TransactionMovement{to: to, amount: amount, type: type}, acc ->
         utxo = %UnspentOutput{from: address, amount: amount, timestamp: timestamp, type: type}
 
-        with true <- Election.chain_storage_node?(to, node_public_key, authorized_nodes),
+        with true <- Election.chain_storage_node?(to, node_public_key, storage_election),
              false <- not skip_verify_consumed? and utxo_consumed?(to, utxo) do
           versioned_utxo = VersionedUnspentOutput.wrap_unspent_output(utxo, protocol_version)
           Map.update(acc, to, [versioned_utxo], &[versioned_utxo | &1])
@@ -121,7 +123,7 @@ defmodule Archethic.UTXO do
     Enum.reduce(recipients, utxos_by_genesis, fn recipient, acc ->
       utxo = %UnspentOutput{from: address, type: :call, timestamp: timestamp}
 
-      with true <- Election.chain_storage_node?(recipient, node_public_key, authorized_nodes),
+      with true <- Election.chain_storage_node?(recipient, node_public_key, storage_election),
            false <- not skip_verify_consumed? and utxo_consumed?(recipient, utxo) do
         versioned_utxo = VersionedUnspentOutput.wrap_unspent_output(utxo, protocol_version)
         Map.update(acc, recipient, [versioned_utxo], &[versioned_utxo | &1])
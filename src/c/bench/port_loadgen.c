@@ -0,0 +1,395 @@
+// Load generator for the native ports speaking the framed protocol of
+// stdio_helpers.c: 4 bytes length + 4 bytes request id + 1 byte fun id + data
+//
+// Usage: port_loadgen -p <program> [-s <fun_id>:<hex>]... -r <fun_id>:<hex>[:<size>]...
+//                     [-c <in_flight>] [-n <requests>]
+//
+//   -p  port executable to spawn
+//   -s  request sent once, waiting for its response, before the benchmark
+//   -r  request to benchmark, the optional size validates the response data
+//   -c  maximum number of requests in flight per benchmarked request (64)
+//   -n  number of requests to send per benchmarked request (10000)
+#include <err.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SPECS 16
+
+typedef struct {
+  unsigned char fun_id;
+  unsigned char *data;
+  int data_len;
+  int expected_len; // -1 when not validated
+
+  int sent;
+  int in_flight;
+  int received;
+  int errors;
+  uint64_t *latencies;
+} spec;
+
+typedef struct {
+  int spec_index;
+  uint64_t sent_at;
+} pending;
+
+static spec specs[MAX_SPECS];
+static int nb_specs = 0;
+static int max_in_flight = 64;
+static int nb_requests = 10000;
+
+static pending *pendings;
+static int nb_pendings;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static bool port_closed = false;
+
+static int to_port;
+static int from_port;
+
+uint64_t now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Split the next field delimited by ':' keeping empty fields
+char *next_field(char **cursor) {
+  if (*cursor == NULL) {
+    return NULL;
+  }
+
+  char *field = *cursor;
+  char *delimiter = strchr(field, ':');
+  if (delimiter == NULL) {
+    *cursor = NULL;
+  } else {
+    *delimiter = '\0';
+    *cursor = delimiter + 1;
+  }
+  return field;
+}
+
+void parse_spec(char *arg, spec *s, bool with_size) {
+  char *cursor = arg;
+  char *fun_id = next_field(&cursor);
+  char *hex = next_field(&cursor);
+  char *size = with_size ? next_field(&cursor) : NULL;
+
+  if (fun_id == NULL || *fun_id == '\0' || cursor != NULL) {
+    errx(EXIT_FAILURE, "invalid request: %s", arg);
+  }
+
+  memset(s, 0, sizeof(spec));
+  s->fun_id = atoi(fun_id);
+  s->expected_len = size == NULL ? -1 : atoi(size);
+
+  int hex_len = hex == NULL ? 0 : strlen(hex);
+  if (hex_len % 2 != 0) {
+    errx(EXIT_FAILURE, "invalid hexadecimal payload: %s", hex);
+  }
+
+  s->data_len = hex_len / 2;
+  s->data = (unsigned char *)malloc(s->data_len + 1);
+  for (int i = 0; i < s->data_len; i++) {
+    if (sscanf(hex + 2 * i, "%2hhx", &s->data[i]) != 1) {
+      errx(EXIT_FAILURE, "invalid hexadecimal payload: %s", hex);
+    }
+  }
+}
+
+int read_exact(unsigned char *buf, int len) {
+  int got = 0;
+  while (got < len) {
+    int i = read(from_port, buf + got, len - got);
+    if (i <= 0) {
+      return i;
+    }
+    got += i;
+  }
+  return len;
+}
+
+void write_exact(unsigned char *buf, int len) {
+  int wrote = 0;
+  while (wrote < len) {
+    int i = write(to_port, buf + wrote, len - wrote);
+    if (i <= 0) {
+      err(EXIT_FAILURE, "port closed");
+    }
+    wrote += i;
+  }
+}
+
+void send_request(uint32_t request_id, spec *s) {
+  int len = 5 + s->data_len;
+  unsigned char frame[4 + len];
+
+  frame[0] = (len >> 24) & 0xFF;
+  frame[1] = (len >> 16) & 0xFF;
+  frame[2] = (len >> 8) & 0xFF;
+  frame[3] = len & 0xFF;
+  frame[4] = (request_id >> 24) & 0x7F;
+  frame[5] = (request_id >> 16) & 0xFF;
+  frame[6] = (request_id >> 8) & 0xFF;
+  frame[7] = request_id & 0xFF;
+  frame[8] = s->fun_id;
+  memcpy(frame + 9, s->data, s->data_len);
+
+  write_exact(frame, 4 + len);
+}
+
+// Read a response, returning its request id or -1 when the port is closed
+int64_t read_response(unsigned char **data, int *data_len) {
+  unsigned char header[4];
+  if (read_exact(header, 4) != 4) {
+    return -1;
+  }
+
+  int len = header[3] | header[2] << 8 | header[1] << 16 | header[0] << 24;
+  if (len < 5) {
+    errx(EXIT_FAILURE, "response too short: %d bytes", len);
+  }
+
+  unsigned char *buf = (unsigned char *)malloc(len);
+  if (read_exact(buf, len) != len) {
+    errx(EXIT_FAILURE, "truncated response");
+  }
+
+  uint32_t request_id = (buf[0] & 0x7F) << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
+  *data = buf;
+  *data_len = len;
+  return request_id;
+}
+
+void setup(spec *s) {
+  send_request(0, s);
+
+  unsigned char *data;
+  int data_len;
+  if (read_response(&data, &data_len) != 0 || data[4] != 1) {
+    errx(EXIT_FAILURE, "setup request %d failed", s->fun_id);
+  }
+  free(data);
+}
+
+void *reader(void *arg __attribute__((unused))) {
+  unsigned char *data;
+  int data_len;
+  int64_t request_id;
+
+  while ((request_id = read_response(&data, &data_len)) >= 0) {
+    uint64_t received_at = now();
+
+    pthread_mutex_lock(&lock);
+    if (request_id < 1 || request_id > nb_pendings ||
+        pendings[request_id - 1].spec_index < 0) {
+      errx(EXIT_FAILURE, "unexpected request id %ld", (long)request_id);
+    }
+
+    pending *p = &pendings[request_id - 1];
+    spec *s = &specs[p->spec_index];
+
+    // Validate the success flag and the size of the data returned
+    if (data[4] != 1 ||
+        (s->expected_len >= 0 && data_len - 5 != s->expected_len)) {
+      s->errors++;
+    }
+
+    s->latencies[s->received++] = received_at - p->sent_at;
+    s->in_flight--;
+    p->spec_index = -1;
+
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+
+    free(data);
+  }
+
+  // Wake up the main thread so it doesn't wait for responses which won't come
+  pthread_mutex_lock(&lock);
+  port_closed = true;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&lock);
+
+  return NULL;
+}
+
+// Wait for the reader to receive responses, with the lock held
+void wait_responses() {
+  if (port_closed) {
+    errx(EXIT_FAILURE, "port exited before answering every request");
+  }
+  pthread_cond_wait(&cond, &lock);
+}
+
+int compare_latencies(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+double percentile(uint64_t *sorted, int count, double p) {
+  int rank = (int)(p * count);
+  if (rank >= count) {
+    rank = count - 1;
+  }
+  return sorted[rank] / 1000.0;
+}
+
+void spawn_port(char *program) {
+  int in[2], out[2];
+  if (pipe(in) != 0 || pipe(out) != 0) {
+    err(EXIT_FAILURE, "cannot create pipes");
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    err(EXIT_FAILURE, "cannot fork");
+  }
+
+  if (pid == 0) {
+    dup2(in[0], 0);
+    dup2(out[1], 1);
+    close(in[1]);
+    close(out[0]);
+    execl(program, program, (char *)NULL);
+    err(EXIT_FAILURE, "cannot execute %s", program);
+  }
+
+  close(in[0]);
+  close(out[1]);
+  to_port = in[1];
+  from_port = out[0];
+}
+
+int main(int argc, char *argv[]) {
+  char *program = NULL;
+  spec setups[MAX_SPECS];
+  int nb_setups = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:s:r:c:n:")) != -1) {
+    switch (opt) {
+    case 'p':
+      program = optarg;
+      break;
+    case 's':
+      if (nb_setups == MAX_SPECS) {
+        errx(EXIT_FAILURE, "too many setup requests");
+      }
+      parse_spec(optarg, &setups[nb_setups++], false);
+      break;
+    case 'r':
+      if (nb_specs == MAX_SPECS) {
+        errx(EXIT_FAILURE, "too many requests");
+      }
+      parse_spec(optarg, &specs[nb_specs++], true);
+      break;
+    case 'c':
+      max_in_flight = atoi(optarg);
+      break;
+    case 'n':
+      nb_requests = atoi(optarg);
+      break;
+    default:
+      errx(EXIT_FAILURE, "usage: %s -p <program> [-s <fun_id>:<hex>]... "
+                         "-r <fun_id>:<hex>[:<size>]... [-c <in_flight>] "
+                         "[-n <requests>]",
+           argv[0]);
+    }
+  }
+
+  if (program == NULL || nb_specs == 0 || max_in_flight < 1 ||
+      nb_requests < 1) {
+    errx(EXIT_FAILURE, "a program and at least one request are required");
+  }
+
+  spawn_port(program);
+
+  for (int i = 0; i < nb_setups; i++) {
+    setup(&setups[i]);
+  }
+
+  nb_pendings = nb_specs * nb_requests;
+  pendings = (pending *)malloc(nb_pendings * sizeof(pending));
+  for (int i = 0; i < nb_specs; i++) {
+    specs[i].latencies = (uint64_t *)malloc(nb_requests * sizeof(uint64_t));
+  }
+
+  pthread_t reader_thread;
+  if (pthread_create(&reader_thread, NULL, reader, NULL) != 0) {
+    err(EXIT_FAILURE, "cannot start reader");
+  }
+
+  uint64_t started_at = now();
+  uint32_t next_id = 1;
+
+  // Keep every request pipelined up to its in flight limit
+  pthread_mutex_lock(&lock);
+  while (next_id <= (uint32_t)nb_pendings) {
+    bool sent = false;
+
+    for (int i = 0; i < nb_specs; i++) {
+      spec *s = &specs[i];
+      if (s->sent < nb_requests && s->in_flight < max_in_flight) {
+        pendings[next_id - 1].spec_index = i;
+        pendings[next_id - 1].sent_at = now();
+        s->sent++;
+        s->in_flight++;
+
+        pthread_mutex_unlock(&lock);
+        send_request(next_id++, s);
+        pthread_mutex_lock(&lock);
+        sent = true;
+      }
+    }
+
+    if (!sent) {
+      wait_responses();
+    }
+  }
+
+  for (int i = 0; i < nb_specs; i++) {
+    while (specs[i].received < nb_requests) {
+      wait_responses();
+    }
+  }
+  pthread_mutex_unlock(&lock);
+
+  double elapsed = (now() - started_at) / 1e9;
+
+  close(to_port);
+  pthread_join(reader_thread, NULL);
+  wait(NULL);
+
+  printf("%s: %d requests in %.3fs, %.0f ops/s, %d in flight per request\n",
+         program, nb_pendings, elapsed, nb_pendings / elapsed, max_in_flight);
+  printf("%8s %8s %8s %12s %10s %10s %10s %10s\n", "fun_id", "requests",
+         "errors", "ops/s", "p50 (us)", "p99 (us)", "p999 (us)", "max (us)");
+
+  int errors = 0;
+  for (int i = 0; i < nb_specs; i++) {
+    spec *s = &specs[i];
+    qsort(s->latencies, s->received, sizeof(uint64_t), compare_latencies);
+
+    printf("%8d %8d %8d %12.0f %10.1f %10.1f %10.1f %10.1f\n", s->fun_id,
+           s->received, s->errors, s->received / elapsed,
+           percentile(s->latencies, s->received, 0.5),
+           percentile(s->latencies, s->received, 0.99),
+           percentile(s->latencies, s->received, 0.999),
+           s->latencies[s->received - 1] / 1000.0);
+
+    errors += s->errors;
+  }
+
+  return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
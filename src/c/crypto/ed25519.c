@@ -1,13 +1,49 @@
 #include <err.h>
+#include <pthread.h>
 #include <sodium.h>
+#include <stdbool.h>
+#include <unistd.h>
 
+#include "ephemeral_pool.h"
+#include "port_stats.h"
 #include "stdio_helpers.h"
 
-enum { CONVERT_PUBLIC_KEY_ED25519_TO_CURVE25519 = 1, CONVERT_SECRET_KEY_ED25519_TO_CURVE25519 = 2 };
+enum {
+    CONVERT_PUBLIC_KEY_ED25519_TO_CURVE25519 = 1,
+    CONVERT_SECRET_KEY_ED25519_TO_CURVE25519 = 2,
+    EPHEMERAL_SHARED_KEY = 3,
+    EPHEMERAL_POOL_DEPTH = 4
+};
 
 void convert_public_key(unsigned char* buf, int pos, int len);
 void convert_secret_key(unsigned char* buf,  int pos, int len);
+void ephemeral_shared_key(unsigned char* buf, int pos, int len);
+void write_pool_depth(unsigned char* buf);
 void write_error(unsigned char* buf, char* error_message, int error_message_len);
+void write_stats(unsigned char* buf);
+void start_ecdh_workers();
+void enqueue_ecdh(unsigned char* buf, int len, uint64_t received_at);
+void stop_ecdh_workers();
+
+// The scalar multiplications of the shared keys are computed by a pool of workers, one per
+// core, so the ECDH of concurrent encryptions runs in parallel and doesn't hold the other
+// requests of the port. Their responses can be sent out of order, the request id identifies them.
+#define MAX_ECDH_WORKERS 16
+
+typedef struct ecdh_request {
+    unsigned char* buf;
+    int len;
+    uint64_t received_at;
+    struct ecdh_request* next;
+} ecdh_request;
+
+static pthread_mutex_t ecdh_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ecdh_cond = PTHREAD_COND_INITIALIZER;
+static ecdh_request* ecdh_head = NULL;
+static ecdh_request* ecdh_tail = NULL;
+static bool ecdh_closed = false;
+static pthread_t ecdh_workers[MAX_ECDH_WORKERS];
+static int nb_ecdh_workers = 0;
 
 int main() {
 
@@ -15,12 +51,19 @@ int main() {
         err(EXIT_FAILURE, "Libsodium cannot be loaded");
     }
 
+    if (ephemeral_pool_start() != 0) {
+        err(EXIT_FAILURE, "Ephemeral key pool cannot be started");
+    }
+
+    start_ecdh_workers();
+
     int len = get_length();
 
     while(len > 0 ) {
 
         unsigned char *buf = (unsigned char *) malloc(len);
         int read_bytes = read_message(buf, len);
+        uint64_t received_at = stats_now();
 
         if (read_bytes != len) {
             free(buf);
@@ -41,6 +84,17 @@ int main() {
         unsigned char fun_id = buf[pos];
         pos++;
 
+        if (fun_id == EPHEMERAL_SHARED_KEY) {
+            // The workers take the ownership of the request
+            enqueue_ecdh(buf, len, received_at);
+            len = get_length();
+            continue;
+        }
+
+        uint64_t started_at = stats_now();
+        stats_record_queue(fun_id, received_at, started_at);
+        trace_request(received_at, started_at);
+
         switch (fun_id) {
             case CONVERT_SECRET_KEY_ED25519_TO_CURVE25519:
                 convert_secret_key(buf, pos, len);
@@ -48,13 +102,106 @@ int main() {
             case CONVERT_PUBLIC_KEY_ED25519_TO_CURVE25519:
                 convert_public_key(buf, pos, len);
                 break;
+            case EPHEMERAL_POOL_DEPTH:
+                write_pool_depth(buf);
+                break;
+            case STATS_FUN_ID:
+                write_stats(buf);
+                break;
             default:
                 err(EXIT_FAILURE, "invalid fun id");
         }
 
+        stats_record_service(fun_id, started_at, stats_now());
+
         free(buf);
         len = get_length();
     }
+
+    stop_ecdh_workers();
+}
+
+ecdh_request* dequeue_ecdh() {
+    pthread_mutex_lock(&ecdh_lock);
+    while (ecdh_head == NULL && !ecdh_closed) {
+        pthread_cond_wait(&ecdh_cond, &ecdh_lock);
+    }
+
+    ecdh_request* request = ecdh_head;
+    if (request != NULL) {
+        ecdh_head = request->next;
+        if (ecdh_head == NULL) {
+            ecdh_tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&ecdh_lock);
+
+    return request;
+}
+
+void* ecdh_worker(void* arg) {
+    (void)arg;
+    ecdh_request* request;
+
+    while ((request = dequeue_ecdh()) != NULL) {
+        uint64_t started_at = stats_now();
+        stats_record_queue(EPHEMERAL_SHARED_KEY, request->received_at, started_at);
+        trace_request(request->received_at, started_at);
+
+        // After the request id and the fun id
+        ephemeral_shared_key(request->buf, 5, request->len);
+
+        stats_record_service(EPHEMERAL_SHARED_KEY, started_at, stats_now());
+
+        free(request->buf);
+        free(request);
+    }
+
+    return NULL;
+}
+
+void start_ecdh_workers() {
+    long nb_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nb_workers = nb_cores < 1 ? 1 : nb_cores > MAX_ECDH_WORKERS ? MAX_ECDH_WORKERS : nb_cores;
+
+    for (; nb_ecdh_workers < nb_workers; nb_ecdh_workers++) {
+        if (pthread_create(&ecdh_workers[nb_ecdh_workers], NULL, ecdh_worker, NULL) != 0) {
+            err(EXIT_FAILURE, "cannot start ECDH worker");
+        }
+    }
+}
+
+void enqueue_ecdh(unsigned char* buf, int len, uint64_t received_at) {
+    ecdh_request* request = (ecdh_request*) malloc(sizeof(ecdh_request));
+    if (request == NULL) {
+        err(EXIT_FAILURE, "cannot allocate ECDH request");
+    }
+    request->buf = buf;
+    request->len = len;
+    request->received_at = received_at;
+    request->next = NULL;
+
+    pthread_mutex_lock(&ecdh_lock);
+    if (ecdh_tail == NULL) {
+        ecdh_head = request;
+    } else {
+        ecdh_tail->next = request;
+    }
+    ecdh_tail = request;
+    pthread_cond_signal(&ecdh_cond);
+    pthread_mutex_unlock(&ecdh_lock);
+}
+
+// Answer the queued requests before exiting
+void stop_ecdh_workers() {
+    pthread_mutex_lock(&ecdh_lock);
+    ecdh_closed = true;
+    pthread_cond_broadcast(&ecdh_cond);
+    pthread_mutex_unlock(&ecdh_lock);
+
+    for (int i = 0; i < nb_ecdh_workers; i++) {
+        pthread_join(ecdh_workers[i], NULL);
+    }
 }
 
 void convert_public_key(unsigned char* buf, int pos, int len) {
@@ -137,6 +284,72 @@ void convert_secret_key(unsigned char* buf, int pos, int len) {
     }
 }
 
+// Derive a shared key between a pooled single-use x25519 keypair and the x25519
+// conversion of the given ed25519 public key. The ephemeral secret key never leaves
+// the port: only the ephemeral public key and the shared key are returned
+void ephemeral_shared_key(unsigned char* buf, int pos, int len) {
+    if (len < pos + crypto_sign_PUBLICKEYBYTES) {
+        write_error(buf, "missing public key", 18);
+        return;
+    }
+
+    unsigned char x25519_pk[crypto_scalarmult_curve25519_BYTES];
+    if (crypto_sign_ed25519_pk_to_curve25519(x25519_pk, buf + pos) != 0) {
+        write_error(buf, "ed25519 public key to curve25519 failed", 39);
+        return;
+    }
+
+    unsigned char ephemeral_pk[crypto_box_PUBLICKEYBYTES];
+    unsigned char ephemeral_sk[crypto_box_SECRETKEYBYTES];
+    ephemeral_pool_take(ephemeral_pk, ephemeral_sk);
+
+    int response_len = 5 + crypto_box_PUBLICKEYBYTES + crypto_scalarmult_BYTES;
+    unsigned char response[response_len];
+
+    if (crypto_scalarmult(response + 5 + crypto_box_PUBLICKEYBYTES, ephemeral_sk, x25519_pk) != 0) {
+        sodium_memzero(ephemeral_sk, sizeof ephemeral_sk);
+        sodium_memzero(response, response_len);
+        write_error(buf, "x25519 shared key failed", 24);
+        return;
+    }
+
+    //Encode request id
+    for (int i = 0; i < 4; i++) {
+        response[i] = buf[i];
+    }
+
+    //Encode response success type
+    response[4] = 1;
+
+    for (int i = 0; i < crypto_box_PUBLICKEYBYTES; i++) {
+        response[5+i] = ephemeral_pk[i];
+    }
+
+    write_response(response, response_len);
+    sodium_memzero(ephemeral_sk, sizeof ephemeral_sk);
+    sodium_memzero(response, response_len);
+}
+
+void write_pool_depth(unsigned char* buf) {
+    int depth = ephemeral_pool_depth();
+    unsigned char response[9];
+
+    //Encode request id
+    for (int i = 0; i < 4; i++) {
+        response[i] = buf[i];
+    }
+
+    //Encode response success type
+    response[4] = 1;
+
+    response[5] = (depth >> 24) & 0xFF;
+    response[6] = (depth >> 16) & 0xFF;
+    response[7] = (depth >> 8) & 0xFF;
+    response[8] = depth & 0xFF;
+
+    write_response(response, 9);
+}
+
 void write_error(unsigned char* buf, char* error_message, int error_message_len) {
     int response_size = 5+error_message_len;
     unsigned char response[response_size];
@@ -155,3 +368,14 @@ void write_error(unsigned char* buf, char* error_message, int error_message_len)
     }
     write_response(response, response_size);
 }
+
+void write_stats(unsigned char* buf) {
+    int response_len = 0;
+    unsigned char *response = stats_encode(buf, &response_len);
+    if (response == NULL) {
+        write_error(buf, "cannot allocate stats", 21);
+    } else {
+        write_response(response, response_len);
+        free(response);
+    }
+}
@@ -0,0 +1,91 @@
+#include <pthread.h>
+#include <sodium.h>
+#include <string.h>
+
+#include "ephemeral_pool.h"
+
+// The pool is refilled by a background thread, so the scalar multiplication of
+// the keypair generation is out of the request path, unless the pool is drained
+// by a burst of requests
+
+typedef struct {
+  unsigned char public_key[crypto_box_PUBLICKEYBYTES];
+  unsigned char secret_key[crypto_box_SECRETKEYBYTES];
+} keypair;
+
+static keypair *pool = NULL;
+static int depth = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
+
+static void *fill_pool(void *arg) {
+  (void)arg;
+  keypair generated;
+  sodium_mlock(&generated, sizeof generated);
+
+  for (;;) {
+    pthread_mutex_lock(&lock);
+    while (depth == EPHEMERAL_POOL_SIZE) {
+      pthread_cond_wait(&not_full, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    crypto_box_keypair(generated.public_key, generated.secret_key);
+
+    pthread_mutex_lock(&lock);
+    if (depth < EPHEMERAL_POOL_SIZE) {
+      pool[depth] = generated;
+      depth++;
+    }
+    pthread_mutex_unlock(&lock);
+
+    sodium_memzero(&generated, sizeof generated);
+  }
+
+  return NULL;
+}
+
+// The pool is allocated with sodium_malloc: locked in memory (never swapped)
+// and surrounded by guard pages
+int ephemeral_pool_start() {
+  pool = (keypair *)sodium_malloc(sizeof(keypair) * EPHEMERAL_POOL_SIZE);
+  if (pool == NULL) {
+    return -1;
+  }
+
+  pthread_t filler;
+  if (pthread_create(&filler, NULL, fill_pool, NULL) != 0) {
+    return -1;
+  }
+  pthread_detach(filler);
+  return 0;
+}
+
+// Hand out a keypair which is removed from the pool, so it is never used twice.
+// A keypair is generated inline when the pool is empty
+void ephemeral_pool_take(unsigned char public_key[crypto_box_PUBLICKEYBYTES],
+                         unsigned char secret_key[crypto_box_SECRETKEYBYTES]) {
+  pthread_mutex_lock(&lock);
+  if (depth == 0) {
+    pthread_mutex_unlock(&lock);
+    crypto_box_keypair(public_key, secret_key);
+    return;
+  }
+
+  depth--;
+  keypair *taken = &pool[depth];
+  memcpy(public_key, taken->public_key, crypto_box_PUBLICKEYBYTES);
+  memcpy(secret_key, taken->secret_key, crypto_box_SECRETKEYBYTES);
+  sodium_memzero(taken, sizeof(keypair));
+
+  pthread_cond_signal(&not_full);
+  pthread_mutex_unlock(&lock);
+}
+
+int ephemeral_pool_depth() {
+  pthread_mutex_lock(&lock);
+  int current_depth = depth;
+  pthread_mutex_unlock(&lock);
+  return current_depth;
+}
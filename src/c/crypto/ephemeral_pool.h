@@ -0,0 +1,9 @@
+#include <sodium.h>
+
+// Number of single-use X25519 keypairs generated in advance
+#define EPHEMERAL_POOL_SIZE 256
+
+int ephemeral_pool_start();
+void ephemeral_pool_take(unsigned char public_key[crypto_box_PUBLICKEYBYTES],
+                         unsigned char secret_key[crypto_box_SECRETKEYBYTES]);
+int ephemeral_pool_depth();
@@ -0,0 +1,175 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "port_stats.h"
+
+// Log-linear buckets (HDR style): values below 8ns have their own bucket,
+// then every power of two is split in 8 sub-buckets, which keeps a relative
+// error under 12.5% up to ~18 minutes
+#define SUB_BUCKET_BITS 3
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define MAX_MAGNITUDE 40
+#define NB_BUCKETS ((MAX_MAGNITUDE - 1) * SUB_BUCKETS)
+
+#define NB_FUN_IDS 256
+
+enum { QUEUE_TIME = 0, SERVICE_TIME = 1, NB_KINDS = 2 };
+
+typedef struct {
+  atomic_uint_fast64_t count;
+  atomic_uint_fast64_t sum;
+  atomic_uint_fast64_t max;
+  atomic_uint_fast64_t buckets[NB_BUCKETS];
+} histogram;
+
+// Recorded from any thread with relaxed atomics, no lock is needed
+static histogram histograms[NB_FUN_IDS][NB_KINDS];
+
+// Timestamps of the request being processed by the current thread
+static _Thread_local uint64_t trace_received_at = 0;
+static _Thread_local uint64_t trace_started_at = 0;
+
+uint64_t stats_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int bucket_index(uint64_t value) {
+  if (value < SUB_BUCKETS) {
+    return value;
+  }
+
+  int magnitude = 63 - __builtin_clzll(value);
+  if (magnitude > MAX_MAGNITUDE) {
+    return NB_BUCKETS - 1;
+  }
+
+  int sub_bucket = (value >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+static uint64_t bucket_lower_bound(int index) {
+  if (index < SUB_BUCKETS) {
+    return index;
+  }
+
+  int magnitude = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  uint64_t sub_bucket = index % SUB_BUCKETS;
+  return (SUB_BUCKETS + sub_bucket) << (magnitude - SUB_BUCKET_BITS);
+}
+
+static void record(histogram *h, uint64_t value) {
+  atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+  atomic_fetch_add_explicit(&h->buckets[bucket_index(value)], 1,
+                            memory_order_relaxed);
+
+  uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+  while (value > max &&
+         !atomic_compare_exchange_weak_explicit(
+             &h->max, &max, value, memory_order_relaxed, memory_order_relaxed))
+    ;
+}
+
+void stats_record_queue(unsigned char fun_id, uint64_t received_at,
+                        uint64_t started_at) {
+  uint64_t elapsed = started_at > received_at ? started_at - received_at : 0;
+  record(&histograms[fun_id][QUEUE_TIME], elapsed);
+}
+
+void stats_record_service(unsigned char fun_id, uint64_t started_at,
+                          uint64_t finished_at) {
+  uint64_t elapsed = finished_at > started_at ? finished_at - started_at : 0;
+  record(&histograms[fun_id][SERVICE_TIME], elapsed);
+}
+
+static int encode_uint64(unsigned char *buf, int pos, uint64_t value) {
+  for (int i = 7; i >= 0; i--) {
+    buf[pos++] = (value >> (i * 8)) & 0xFF;
+  }
+  return pos;
+}
+
+void trace_request(uint64_t received_at, uint64_t started_at) {
+  trace_received_at = received_at;
+  trace_started_at = started_at;
+}
+
+// Encode the received, started and finished timestamps of the current request
+void encode_trace_header(unsigned char *header) {
+  int pos = encode_uint64(header, 0, trace_received_at);
+  pos = encode_uint64(header, pos, trace_started_at);
+  encode_uint64(header, pos, stats_now());
+}
+
+// Encode the non empty histograms as:
+// [fun_id:8, kind:8, count:64, sum:64, max:64, nb_buckets:16,
+//    [lower_bound:64, count:64] * nb_buckets] *
+unsigned char *stats_encode(unsigned char *request_id, int *response_len) {
+  int max_histogram_size = 28 + NB_BUCKETS * 16;
+  int capacity = 5;
+  for (int fun_id = 0; fun_id < NB_FUN_IDS; fun_id++) {
+    for (int kind = 0; kind < NB_KINDS; kind++) {
+      if (atomic_load_explicit(&histograms[fun_id][kind].count,
+                               memory_order_relaxed) > 0) {
+        capacity += max_histogram_size;
+      }
+    }
+  }
+
+  unsigned char *response = (unsigned char *)malloc(capacity);
+  if (response == NULL) {
+    return NULL;
+  }
+
+  // Encode request id
+  memcpy(response, request_id, 4);
+
+  // Encode response success type
+  response[4] = 1;
+
+  int pos = 5;
+  for (int fun_id = 0; fun_id < NB_FUN_IDS; fun_id++) {
+    for (int kind = 0; kind < NB_KINDS; kind++) {
+      histogram *h = &histograms[fun_id][kind];
+      uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+
+      // Histograms recorded after the capacity computation are skipped
+      if (count == 0 || pos + max_histogram_size > capacity) {
+        continue;
+      }
+
+      response[pos++] = fun_id;
+      response[pos++] = kind;
+      pos = encode_uint64(response, pos, count);
+      pos = encode_uint64(
+          response, pos, atomic_load_explicit(&h->sum, memory_order_relaxed));
+      pos = encode_uint64(
+          response, pos, atomic_load_explicit(&h->max, memory_order_relaxed));
+
+      int nb_buckets_pos = pos;
+      int nb_buckets = 0;
+      pos += 2;
+
+      for (int i = 0; i < NB_BUCKETS; i++) {
+        uint64_t bucket_count =
+            atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (bucket_count > 0) {
+          pos = encode_uint64(response, pos, bucket_lower_bound(i));
+          pos = encode_uint64(response, pos, bucket_count);
+          nb_buckets++;
+        }
+      }
+
+      response[nb_buckets_pos] = (nb_buckets >> 8) & 0xFF;
+      response[nb_buckets_pos + 1] = nb_buckets & 0xFF;
+    }
+  }
+
+  *response_len = pos;
+  return response;
+}
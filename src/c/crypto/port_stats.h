@@ -0,0 +1,18 @@
+#include <stdint.h>
+
+// Reserved function id answering the latency histograms of the port
+#define STATS_FUN_ID 255
+
+// Highest bit of the request id asking to echo the native timestamps
+#define TRACE_FLAG 0x80
+#define TRACE_HEADER_SIZE 24
+
+uint64_t stats_now();
+void stats_record_queue(unsigned char fun_id, uint64_t received_at,
+                        uint64_t started_at);
+void stats_record_service(unsigned char fun_id, uint64_t started_at,
+                          uint64_t finished_at);
+unsigned char *stats_encode(unsigned char *request_id, int *response_len);
+
+void trace_request(uint64_t received_at, uint64_t started_at);
+void encode_trace_header(unsigned char *header);
@@ -1,7 +1,34 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <err.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "port_stats.h"
+
+// Responses are buffered while more requests are already waiting on stdin, so
+// a burst of requests is answered with a single write. The buffer is flushed as
+// soon as no request is pending, before waiting for the next request or when
+// it's full.
+// Under sustained load stdin never drains, so the deferral is also capped by
+// the number of responses buffered and by the age of the oldest one, to not
+// hold the first responses of a burst until its end.
+// The responses can carry secrets (shared keys, x25519 secret keys, node seed),
+// so the buffer is locked in memory, kept out of the core dumps and wiped once
+// written.
+#define OUTPUT_BUFFER_SIZE 65536
+#define MAX_BUFFERED_RESPONSES 32
+#define MAX_BUFFERED_AGE_NS 200000
+
+static unsigned char output[OUTPUT_BUFFER_SIZE] __attribute__((aligned(4096)));
+static pthread_once_t output_locked = PTHREAD_ONCE_INIT;
+static int output_len = 0;
+static int output_count = 0;
+static uint64_t output_since = 0;
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
 
 int _read_exact(unsigned char *buf, int len) {
     int i, got=0;
@@ -31,9 +58,69 @@ int _write_exact(unsigned char *buf, int len)
   return (len);
 }
 
+// Best effort, as sodium_malloc does: a low RLIMIT_MEMLOCK must not stop the port
+static void lock_output() {
+  mlock(output, sizeof output);
+  madvise(output, sizeof output, MADV_DONTDUMP);
+}
+
+static int input_pending() {
+  struct pollfd fd = {.fd = 0, .events = POLLIN};
+  return poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN);
+}
+
+// Must be called with the output lock held
+static int flush_output() {
+  int wrote = 0;
+  if (output_len > 0) {
+    wrote = _write_exact(output, output_len);
+    explicit_bzero(output, output_len);
+    output_len = 0;
+  }
+  output_count = 0;
+  return wrote;
+}
+
+// Must be called with the output lock held
+static int deferral_exceeded() {
+  return output_count >= MAX_BUFFERED_RESPONSES ||
+         stats_now() - output_since >= MAX_BUFFERED_AGE_NS;
+}
+
+// Must be called with the output lock held
+static int append_output(unsigned char *data, int len) {
+  pthread_once(&output_locked, lock_output);
+
+  if (output_len + len > OUTPUT_BUFFER_SIZE) {
+    if (flush_output() < 0) {
+      return -1;
+    }
+
+    // Too large to be buffered
+    if (len > OUTPUT_BUFFER_SIZE) {
+      return _write_exact(data, len);
+    }
+  }
+
+  memcpy(output + output_len, data, len);
+  output_len += len;
+  return len;
+}
+
 int get_length() {
+  // The requests handled by worker threads answer nothing in the reading loop,
+  // so the deferral cap is also checked before reading the next request
+  pthread_mutex_lock(&output_lock);
+  if (!input_pending() || (output_count > 0 && deferral_exceeded())) {
+    flush_output();
+  }
+  pthread_mutex_unlock(&output_lock);
+
   unsigned char size_header[4];
   if (_read_exact(size_header, 4) != 4) {
+    pthread_mutex_lock(&output_lock);
+    flush_output();
+    pthread_mutex_unlock(&output_lock);
     return 0;
   }
 
@@ -53,12 +140,45 @@ int write_response(unsigned char *buf, int len)
 {
   unsigned char size_header[4];
 
-  size_header[0] = (len >> 24) & 0xFF;
-  size_header[1] = (len >> 16) & 0xFF;
-  size_header[2] = (len >> 8) & 0xFF;
-  size_header[3] = len & 0xFF;
+  // Traced responses carry the native timestamps right after the request id
+  int traced = len >= 4 && (buf[0] & TRACE_FLAG);
+  int size = traced ? len + TRACE_HEADER_SIZE : len;
+
+  size_header[0] = (size >> 24) & 0xFF;
+  size_header[1] = (size >> 16) & 0xFF;
+  size_header[2] = (size >> 8) & 0xFF;
+  size_header[3] = size & 0xFF;
+
+  pthread_mutex_lock(&output_lock);
+
+  if (output_count == 0) {
+    output_since = stats_now();
+  }
 
-  _write_exact(size_header, 4);
+  int wrote = append_output(size_header, 4);
+
+  if (wrote >= 0 && traced) {
+    unsigned char trace_header[TRACE_HEADER_SIZE];
+    encode_trace_header(trace_header);
+
+    wrote = append_output(buf, 4);
+    if (wrote >= 0) {
+      wrote = append_output(trace_header, TRACE_HEADER_SIZE);
+    }
+    if (wrote >= 0) {
+      wrote = append_output(buf + 4, len - 4);
+    }
+  } else if (wrote >= 0) {
+    wrote = append_output(buf, len);
+  }
+
+  if (wrote >= 0) {
+    output_count++;
+    if (deferral_exceeded() || !input_pending()) {
+      wrote = flush_output();
+    }
+  }
 
-  return _write_exact(buf, len);
+  pthread_mutex_unlock(&output_lock);
+  return wrote < 0 ? wrote : len;
 }
@@ -1,6 +1,8 @@
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include <tss2/tss2_esys.h>
 #include <tss2/tss2_mu.h>
@@ -16,6 +18,7 @@
 #define ANS1_MAX_KEY_SIZE 4 + 9 + 10 + 4 + PRIME_LEN + PRIME_LEN
 
 #define NV_INDEX 0x1880650
+#define SEED_LEN 32
 
 static ESYS_CONTEXT *esysContext;
 int rc;
@@ -44,6 +47,39 @@ static BYTE tempKey[ANS1_MAX_KEY_SIZE];
 static BYTE sigEccASN[2 + 2 + PRIME_LEN + 2 + PRIME_LEN + 2];
 static BYTE zPoint[2 * PRIME_LEN + 1];
 
+static ESYS_TR nvSession = ESYS_TR_NONE;
+static ESYS_TR nvHandle = ESYS_TR_NONE;
+static BYTE *nodeSeed = NULL;
+
+// Snapshot of the public keys and seed which can be read from any thread
+// while the TPM is busy with another command
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+  bool ready;
+  BYTE rootKeyASN[ANS1_MAX_KEY_SIZE];
+  INT rootKeySizeASN;
+  BYTE previousKeyASN[ANS1_MAX_KEY_SIZE];
+  INT previousKeySizeASN;
+  INT previousKeyIndex;
+  BYTE nextKeyASN[ANS1_MAX_KEY_SIZE];
+  INT nextKeySizeASN;
+  INT nextKeyIndex;
+} keyCache = {.ready = false};
+
+void publishKeyCache() {
+  pthread_mutex_lock(&cacheLock);
+  memcpy(keyCache.rootKeyASN, rootKeyASN, rootKeySizeASN);
+  keyCache.rootKeySizeASN = rootKeySizeASN;
+  memcpy(keyCache.previousKeyASN, previousKeyASN, previousKeySizeASN);
+  keyCache.previousKeySizeASN = previousKeySizeASN;
+  keyCache.previousKeyIndex = previousKeyIndex;
+  memcpy(keyCache.nextKeyASN, nextKeyASN, nextKeySizeASN);
+  keyCache.nextKeySizeASN = nextKeySizeASN;
+  keyCache.nextKeyIndex = nextKeyIndex;
+  keyCache.ready = true;
+  pthread_mutex_unlock(&cacheLock);
+}
+
 void keyToASN() {
   BYTE asnHeader[] = {ASN1_SEQ, 0x59, ASN1_SEQ, 0x13};
   BYTE keyType[] = {ASN1_OID, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01};
@@ -243,6 +279,8 @@ void updateHandlesIndexes() {
   memset(nextKeyASN, 0, ANS1_MAX_KEY_SIZE);
   memcpy(nextKeyASN, currentKeyASN, currentKeySizeASN);
   nextKeySizeASN = currentKeySizeASN;
+
+  publishKeyCache();
 }
 
 void setKeyIndex(INT keyIndex) {
@@ -272,23 +310,31 @@ void setKeyIndex(INT keyIndex) {
   memcpy(nextKeyASN, currentKeyASN, currentKeySizeASN);
 
   currentKeyHandle = ESYS_TR_NONE;
+
+  publishKeyCache();
 }
 
-void provisionNodeSeed() {
-  ESYS_TR session = ESYS_TR_NONE;
+void startNVSession() {
+  if (nvSession != ESYS_TR_NONE) {
+    return;
+  }
+
   TPMT_SYM_DEF symmetric = {.algorithm = TPM2_ALG_AES,
                             .keyBits = {.aes = 128},
                             .mode = {.aes = TPM2_ALG_CFB}};
 
   rc = Esys_StartAuthSession(
       esysContext, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
-      ESYS_TR_NONE, NULL, TPM2_SE_HMAC, &symmetric, TPM2_ALG_SHA256, &session);
+      ESYS_TR_NONE, NULL, TPM2_SE_HMAC, &symmetric, TPM2_ALG_SHA256,
+      &nvSession);
   if (rc != TSS2_RC_SUCCESS) {
     printf("\nError: Start session -> %s \n", Tss2_RC_Decode(rc));
     exit(1);
   }
 
-  rc = Esys_TRSess_SetAttributes(esysContext, session,
+  // The session is kept open across commands so every NV operation
+  // reuses the same encrypted channel
+  rc = Esys_TRSess_SetAttributes(esysContext, nvSession,
                                  TPMA_SESSION_DECRYPT | TPMA_SESSION_ENCRYPT |
                                      TPMA_SESSION_CONTINUESESSION,
                                  0xff);
@@ -296,6 +342,46 @@ void provisionNodeSeed() {
     printf("\nError: Set session attributes -> %s\n", Tss2_RC_Decode(rc));
     exit(1);
   }
+}
+
+ESYS_TR getNVSession() {
+  startNVSession();
+  return nvSession;
+}
+
+ESYS_TR getNVHandle() {
+  if (nvHandle != ESYS_TR_NONE) {
+    return nvHandle;
+  }
+
+  rc = Esys_TR_FromTPMPublic(esysContext, NV_INDEX, ESYS_TR_NONE, ESYS_TR_NONE,
+                             ESYS_TR_NONE, &nvHandle);
+  if (rc != TSS2_RC_SUCCESS) {
+    printf("\nError: Read TPM Public -> %s\n", Tss2_RC_Decode(rc));
+    exit(1);
+  }
+
+  return nvHandle;
+}
+
+void releaseNVSession() {
+  pthread_mutex_lock(&cacheLock);
+  if (nodeSeed != NULL) {
+    explicit_bzero(nodeSeed, SEED_LEN);
+    munlock(nodeSeed, SEED_LEN);
+    free(nodeSeed);
+    nodeSeed = NULL;
+  }
+  pthread_mutex_unlock(&cacheLock);
+
+  if (nvSession != ESYS_TR_NONE) {
+    Esys_FlushContext(esysContext, nvSession);
+    nvSession = ESYS_TR_NONE;
+  }
+}
+
+void provisionNodeSeed() {
+  ESYS_TR session = getNVSession();
 
   // Search the NV index
   TPMS_CAPABILITY_DATA *capability_data = NULL;
@@ -309,25 +395,24 @@ void provisionNodeSeed() {
 
   int exists = (capability_data->data.handles.count > 0 &&
                 capability_data->data.handles.handle[0] == NV_INDEX);
+  Esys_Free(capability_data);
   if (exists == 1) {
     return;
   }
 
-  ESYS_TR nvHandle = ESYS_TR_NONE;
-
   TPM2B_NV_PUBLIC publicInfo = {
       .size = sizeof(publicInfo.nvPublic),
       .nvPublic = {.attributes = TPM2_NT_ORDINARY | TPMA_NV_WRITEALL |
                                  TPMA_NV_AUTHWRITE | TPMA_NV_POLICYREAD |
                                  TPMA_NV_AUTHREAD | TPMA_NV_OWNERREAD,
-                   .dataSize = 32,
+                   .dataSize = SEED_LEN,
                    .nameAlg = TPM2_ALG_SHA256,
                    .nvIndex = NV_INDEX,
                    .authPolicy = {.size = 0, .buffer = {}}}};
 
   TPM2B_AUTH nullAuth = {.size = 0};
 
-  // Create the NV index
+  // Create the NV index, its handle is kept for the next NV operations
   rc = Esys_NV_DefineSpace(esysContext, ESYS_TR_RH_OWNER, session, ESYS_TR_NONE,
                            ESYS_TR_NONE, &nullAuth, &publicInfo, &nvHandle);
 
@@ -338,8 +423,8 @@ void provisionNodeSeed() {
 
   // Generate random bytes
   TPM2B_DIGEST *seed;
-  rc = Esys_GetRandom(esysContext, session, ESYS_TR_NONE, ESYS_TR_NONE, 32,
-                      &seed);
+  rc = Esys_GetRandom(esysContext, session, ESYS_TR_NONE, ESYS_TR_NONE,
+                      SEED_LEN, &seed);
   if (rc != TSS2_RC_SUCCESS) {
     printf("\nError: Get random after session -> %s \n", Tss2_RC_Decode(rc));
     exit(1);
@@ -353,16 +438,19 @@ void provisionNodeSeed() {
     exit(1);
   }
 
+  explicit_bzero(seed->buffer, seed->size);
   Esys_Free(seed);
-
-  rc = Esys_FlushContext(esysContext, session);
-  if (rc != TSS2_RC_SUCCESS) {
-    printf("\nError: Context flushing -> %s \n", Tss2_RC_Decode(rc));
-    exit(1);
-  }
 }
 
 void initializeTPM(INT keyIndex) {
+  pthread_mutex_lock(&cacheLock);
+  keyCache.ready = false;
+  pthread_mutex_unlock(&cacheLock);
+
+  // Session and NV handles are bound to the ESYS context being replaced
+  releaseNVSession();
+  nvHandle = ESYS_TR_NONE;
+
   rc = Esys_Initialize(&esysContext, NULL, NULL);
   if (rc != TSS2_RC_SUCCESS) {
     printf("\nError: Esys Initialization Failed -> %s\n", Tss2_RC_Decode(rc));
@@ -448,46 +536,76 @@ BYTE *signECDSA(INT keyIndex, BYTE *hashToSign, INT *eccSignSize,
 }
 
 BYTE *retrieveNodeSeed() {
-  ESYS_TR session = ESYS_TR_NONE;
-  TPMT_SYM_DEF symmetric = {.algorithm = TPM2_ALG_AES,
-                            .keyBits = {.aes = 128},
-                            .mode = {.aes = TPM2_ALG_CFB}};
+  // The seed never changes once provisioned, so it is read only once and kept
+  // in locked memory to avoid the NV round trips on every request
+  if (nodeSeed != NULL) {
+    return nodeSeed;
+  }
 
-  rc = Esys_StartAuthSession(
-      esysContext, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
-      ESYS_TR_NONE, NULL, TPM2_SE_HMAC, &symmetric, TPM2_ALG_SHA256, &session);
+  TPM2B_MAX_NV_BUFFER *seed = NULL;
+  rc = Esys_NV_Read(esysContext, getNVHandle(), getNVHandle(), getNVSession(),
+                    ESYS_TR_NONE, ESYS_TR_NONE, SEED_LEN, 0, &seed);
   if (rc != TSS2_RC_SUCCESS) {
-    printf("\nError: Start session failed -> %s \n", Tss2_RC_Decode(rc));
+    printf("\nError: NV Read -> %s\n", Tss2_RC_Decode(rc));
     exit(1);
   }
 
-  rc = Esys_TRSess_SetAttributes(esysContext, session,
-                                 TPMA_SESSION_DECRYPT | TPMA_SESSION_ENCRYPT |
-                                     TPMA_SESSION_CONTINUESESSION,
-                                 0xff);
-  if (rc != TSS2_RC_SUCCESS) {
-    printf("\nError: Set session attributes -> %s\n", Tss2_RC_Decode(rc));
+  if (seed->size != SEED_LEN) {
+    printf("\nError: NV Read -> unexpected seed size %d\n", seed->size);
+    explicit_bzero(seed->buffer, seed->size);
+    Esys_Free(seed);
     exit(1);
   }
 
-  // Get the NV Index handle
-  ESYS_TR nvHandle = ESYS_TR_NONE;
-  rc = Esys_TR_FromTPMPublic(esysContext, NV_INDEX, ESYS_TR_NONE, ESYS_TR_NONE,
-                             ESYS_TR_NONE, &nvHandle);
-  if (rc != TSS2_RC_SUCCESS) {
-    printf("\nError: Read TPM Public -> %s\n", Tss2_RC_Decode(rc));
+  BYTE *lockedSeed = malloc(SEED_LEN);
+  if (lockedSeed == NULL || mlock(lockedSeed, SEED_LEN) != 0) {
+    printf("\nError: Cannot lock node seed memory\n");
     exit(1);
   }
+  memcpy(lockedSeed, seed->buffer, SEED_LEN);
 
-  TPM2B_MAX_NV_BUFFER *seed = NULL;
-  rc = Esys_NV_Read(esysContext, nvHandle, nvHandle, session, ESYS_TR_NONE,
-                    ESYS_TR_NONE, 32, 0, &seed);
-  if (rc != TSS2_RC_SUCCESS) {
-    printf("\nError: NV Read -> %s\n", Tss2_RC_Decode(rc));
-    exit(1);
+  pthread_mutex_lock(&cacheLock);
+  nodeSeed = lockedSeed;
+  pthread_mutex_unlock(&cacheLock);
+
+  explicit_bzero(seed->buffer, seed->size);
+  Esys_Free(seed);
+
+  return nodeSeed;
+}
+
+bool copyCachedPublicKey(INT keyIndex, BYTE *publicKey, INT *publicKeySize) {
+  bool found = true;
+
+  pthread_mutex_lock(&cacheLock);
+  if (!keyCache.ready) {
+    found = false;
+  } else if (keyIndex == keyCache.nextKeyIndex) {
+    memcpy(publicKey, keyCache.nextKeyASN, keyCache.nextKeySizeASN);
+    *publicKeySize = keyCache.nextKeySizeASN;
+  } else if (keyIndex == keyCache.previousKeyIndex) {
+    memcpy(publicKey, keyCache.previousKeyASN, keyCache.previousKeySizeASN);
+    *publicKeySize = keyCache.previousKeySizeASN;
+  } else if (keyIndex == 0) {
+    memcpy(publicKey, keyCache.rootKeyASN, keyCache.rootKeySizeASN);
+    *publicKeySize = keyCache.rootKeySizeASN;
+  } else {
+    found = false;
   }
+  pthread_mutex_unlock(&cacheLock);
 
-  Esys_FlushContext(esysContext, session);
+  return found;
+}
+
+bool copyCachedNodeSeed(BYTE *seed) {
+  bool found = false;
+
+  pthread_mutex_lock(&cacheLock);
+  if (nodeSeed != NULL) {
+    memcpy(seed, nodeSeed, SEED_LEN);
+    found = true;
+  }
+  pthread_mutex_unlock(&cacheLock);
 
-  return seed->buffer;
+  return found;
 }
@@ -2,10 +2,18 @@
 typedef unsigned char BYTE;
 typedef unsigned short INT;
 
+#define PUBLIC_KEY_MAX_SIZE 91
+#define NODE_SEED_SIZE 32
+
 void initializeTPM(INT keyIndex);
 
 BYTE *getPublicKey(INT keyIndex, INT *publicKeySize);
 BYTE *signECDSA(INT keyIndex, BYTE *hashToSign, INT *eccSignSize,
                 bool increment);
 
-BYTE *retrieveNodeSeed();
\ No newline at end of file
+BYTE *retrieveNodeSeed();
+void releaseNVSession();
+
+// Thread safe lookups served without any TPM command
+bool copyCachedPublicKey(INT keyIndex, BYTE *publicKey, INT *publicKeySize);
+bool copyCachedNodeSeed(BYTE *seed);
@@ -1,12 +1,33 @@
+#include "../port_stats.h"
 #include "../stdio_helpers.h"
 #include "lib.h"
 #include <err.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 void write_error(unsigned char *buf, char *error_message,
                  int error_message_len);
 
+// TPM commands are executed one at a time by a single worker, while lookups
+// answered from memory are replied directly by the reader thread.
+// Responses can then be sent out of order, the request id identifies them.
+typedef struct command {
+  unsigned char *buf;
+  int len;
+  uint64_t received_at;
+  struct command *next;
+} command;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static command *queue_head = NULL;
+static command *queue_tail = NULL;
+static bool queue_closed = false;
+
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+
 enum {
   INITIALIZE = 1,
   GET_PUBLIC_KEY = 2,
@@ -14,6 +35,15 @@ enum {
   RETRIEVE_NODE_SEED = 4
 };
 
+void reply_public_key(unsigned char *buf, BYTE *asnkey, INT publicKeySize);
+
+int reply(unsigned char *response, int response_len) {
+  pthread_mutex_lock(&write_lock);
+  int wrote = write_response(response, response_len);
+  pthread_mutex_unlock(&write_lock);
+  return wrote;
+}
+
 void initialize_tpm(unsigned char *buf, int pos, int len) {
   if (len < pos + 2) {
     write_error(buf, "missing index", 13);
@@ -36,7 +66,7 @@ void initialize_tpm(unsigned char *buf, int pos, int len) {
 
     // Encoding of success
     response[4] = 1;
-    write_response(response, response_len);
+    reply(response, response_len);
   }
 }
 
@@ -54,22 +84,7 @@ void get_public_key(unsigned char *buf, int pos, int len) {
     BYTE *asnkey;
     INT publicKeySize = 0;
     asnkey = getPublicKey(index_int, &publicKeySize);
-    int response_len = 5 + publicKeySize;
-
-    unsigned char response[response_len];
-    // Encode request's ID
-    for (int i = 0; i < 4; i++) {
-      response[i] = buf[i];
-    }
-
-    // Encoding of success
-    response[4] = 1;
-
-    for (int i = 0; i < publicKeySize; i++) {
-      response[5 + i] = asnkey[i];
-    }
-
-    write_response(response, response_len);
+    reply_public_key(buf, asnkey, publicKeySize);
   }
 }
 
@@ -110,7 +125,7 @@ void sign_ecdsa(unsigned char *buf, int pos, int len) {
       response[5 + i] = eccSign[i];
     }
 
-    write_response(response, response_len);
+    reply(response, response_len);
   }
 }
 
@@ -133,16 +148,165 @@ void getNodeSeed(unsigned char *buf, int pos, int len) {
     response[5 + i] = seed[i];
   }
 
-  write_response(response, response_len);
+  reply(response, response_len);
+}
+
+void reply_public_key(unsigned char *buf, BYTE *asnkey, INT publicKeySize) {
+  int response_len = 5 + publicKeySize;
+  unsigned char response[response_len];
+
+  // Encode request's ID
+  for (int i = 0; i < 4; i++) {
+    response[i] = buf[i];
+  }
+
+  // Encoding of success
+  response[4] = 1;
+
+  for (int i = 0; i < publicKeySize; i++) {
+    response[5 + i] = asnkey[i];
+  }
+
+  reply(response, response_len);
+}
+
+bool fast_path(unsigned char *buf, int pos, int len, unsigned char fun_id) {
+  switch (fun_id) {
+  case GET_PUBLIC_KEY: {
+    if (len < pos + 2) {
+      return false;
+    }
+
+    INT index_int = buf[pos + 1] | buf[pos] << 8;
+    BYTE asnkey[PUBLIC_KEY_MAX_SIZE];
+    INT publicKeySize = 0;
+    if (!copyCachedPublicKey(index_int, asnkey, &publicKeySize)) {
+      return false;
+    }
+
+    reply_public_key(buf, asnkey, publicKeySize);
+    return true;
+  }
+  case STATS_FUN_ID: {
+    int response_len = 0;
+    unsigned char *response = stats_encode(buf, &response_len);
+    if (response == NULL) {
+      write_error(buf, "cannot allocate stats", 21);
+    } else {
+      reply(response, response_len);
+      free(response);
+    }
+    return true;
+  }
+  case RETRIEVE_NODE_SEED: {
+    unsigned char response[5 + NODE_SEED_SIZE];
+    if (!copyCachedNodeSeed(response + 5)) {
+      return false;
+    }
+
+    for (int i = 0; i < 4; i++) {
+      response[i] = buf[i];
+    }
+    response[4] = 1;
+
+    reply(response, sizeof(response));
+    explicit_bzero(response, sizeof(response));
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+void enqueue(unsigned char *buf, int len, uint64_t received_at) {
+  command *cmd = (command *)malloc(sizeof(command));
+  if (cmd == NULL) {
+    err(EXIT_FAILURE, "cannot allocate command");
+  }
+  cmd->buf = buf;
+  cmd->len = len;
+  cmd->received_at = received_at;
+  cmd->next = NULL;
+
+  pthread_mutex_lock(&queue_lock);
+  if (queue_tail == NULL) {
+    queue_head = cmd;
+  } else {
+    queue_tail->next = cmd;
+  }
+  queue_tail = cmd;
+  pthread_cond_signal(&queue_cond);
+  pthread_mutex_unlock(&queue_lock);
+}
+
+command *dequeue() {
+  pthread_mutex_lock(&queue_lock);
+  while (queue_head == NULL && !queue_closed) {
+    pthread_cond_wait(&queue_cond, &queue_lock);
+  }
+
+  command *cmd = queue_head;
+  if (cmd != NULL) {
+    queue_head = cmd->next;
+    if (queue_head == NULL) {
+      queue_tail = NULL;
+    }
+  }
+  pthread_mutex_unlock(&queue_lock);
+
+  return cmd;
+}
+
+void *tpm_worker(void *arg) {
+  command *cmd;
+
+  while ((cmd = dequeue()) != NULL) {
+    unsigned char *buf = cmd->buf;
+    int len = cmd->len;
+    int pos = 5; // After the request id and the fun id
+
+    uint64_t started_at = stats_now();
+    stats_record_queue(buf[4], cmd->received_at, started_at);
+    trace_request(cmd->received_at, started_at);
+
+    switch (buf[4]) {
+
+    case INITIALIZE:
+      initialize_tpm(buf, pos, len);
+      break;
+    case GET_PUBLIC_KEY:
+      get_public_key(buf, pos, len);
+      break;
+    case SIGN_ECDSA:
+      sign_ecdsa(buf, pos, len);
+      break;
+    case RETRIEVE_NODE_SEED:
+      getNodeSeed(buf, pos, len);
+      break;
+    }
+
+    stats_record_service(buf[4], started_at, stats_now());
+
+    free(buf);
+    free(cmd);
+  }
+
+  return NULL;
 }
 
 int main() {
+  pthread_t worker;
+  if (pthread_create(&worker, NULL, tpm_worker, NULL) != 0) {
+    err(EXIT_FAILURE, "cannot start TPM worker");
+  }
+
   int len = get_length();
 
   while (len > 0) {
 
     unsigned char *buf = (unsigned char *)malloc(len);
     int read_bytes = read_message(buf, len);
+    uint64_t received_at = stats_now();
 
     if (read_bytes != len) {
       free(buf);
@@ -163,25 +327,27 @@ int main() {
     unsigned char fun_id = buf[pos];
     pos++;
 
-    switch (fun_id) {
-
-    case INITIALIZE:
-      initialize_tpm(buf, pos, len);
-      break;
-    case GET_PUBLIC_KEY:
-      get_public_key(buf, pos, len);
-      break;
-    case SIGN_ECDSA:
-      sign_ecdsa(buf, pos, len);
-      break;
-    case RETRIEVE_NODE_SEED:
-      getNodeSeed(buf, pos, len);
-      break;
+    trace_request(received_at, received_at);
+    if (fast_path(buf, pos, len, fun_id)) {
+      uint64_t finished_at = stats_now();
+      stats_record_queue(fun_id, received_at, received_at);
+      stats_record_service(fun_id, received_at, finished_at);
+      free(buf);
+    } else {
+      enqueue(buf, len, received_at);
     }
 
-    free(buf);
     len = get_length();
   }
+
+  pthread_mutex_lock(&queue_lock);
+  queue_closed = true;
+  pthread_cond_signal(&queue_cond);
+  pthread_mutex_unlock(&queue_lock);
+
+  pthread_join(worker, NULL);
+
+  releaseNVSession();
 }
 
 void write_error(unsigned char *buf, char *error_message,
@@ -201,5 +367,5 @@ void write_error(unsigned char *buf, char *error_message,
   for (int i = 0; i < error_message_len; i++) {
     response[5 + i] = error_message[i];
   }
-  write_response(response, response_size);
+  reply(response, response_size);
 }
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bloom.h"
+#include "summary.h"
+
+// 16 bits per address and 8 probes give ~0.06% of false positives
+#define BITS_PER_ENTRY 16
+#define NB_PROBES 8
+
+#define BLOOM_MAGIC "AESB"
+#define BLOOM_VERSION 2
+
+// Bloom files are local to the node, integers are in the host's byte order
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint64_t nb_bits;
+  uint64_t capacity;
+  uint64_t count;
+  uint64_t covered;
+  summary_identity summary;
+} bloom_header;
+
+int bloom_init(bloom_filter *filter, uint64_t capacity) {
+  // Power of two to select the bits with a mask
+  uint64_t nb_bits = 64;
+  while (nb_bits < capacity * BITS_PER_ENTRY) {
+    nb_bits <<= 1;
+  }
+
+  filter->bits = (uint64_t *)calloc(nb_bits / 64, sizeof(uint64_t));
+  if (filter->bits == NULL) {
+    return -1;
+  }
+
+  filter->nb_bits = nb_bits;
+  filter->capacity = capacity;
+  filter->count = 0;
+  filter->covered = 0;
+  filter->dirty = true;
+  return 0;
+}
+
+void bloom_free(bloom_filter *filter) {
+  free(filter->bits);
+  memset(filter, 0, sizeof(bloom_filter));
+}
+
+// The digest is uniformly distributed: two of its words seed the
+// double hashing of the probes
+static void probes_seed(const unsigned char *address, uint64_t *h1,
+                        uint64_t *h2) {
+  *h1 = address_fingerprint(address);
+  *h2 = 0;
+  for (int i = 11; i < 19; i++) {
+    *h2 = *h2 << 8 | address[i];
+  }
+  *h2 |= 1;
+}
+
+void bloom_add(bloom_filter *filter, const unsigned char *address) {
+  uint64_t h1, h2;
+  probes_seed(address, &h1, &h2);
+
+  uint64_t mask = filter->nb_bits - 1;
+  for (int i = 0; i < NB_PROBES; i++) {
+    uint64_t bit = (h1 + i * h2) & mask;
+    filter->bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+  }
+  filter->dirty = true;
+}
+
+bool bloom_contains(const bloom_filter *filter, const unsigned char *address) {
+  uint64_t h1, h2;
+  probes_seed(address, &h1, &h2);
+
+  uint64_t mask = filter->nb_bits - 1;
+  for (int i = 0; i < NB_PROBES; i++) {
+    uint64_t bit = (h1 + i * h2) & mask;
+    if ((filter->bits[bit / 64] & ((uint64_t)1 << (bit % 64))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Load the filter with the identity of the summary prefix it covers
+int bloom_load(const char *path, bloom_filter *filter,
+               summary_identity *identity) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    return -1;
+  }
+
+  bloom_header header;
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      memcmp(header.magic, BLOOM_MAGIC, 4) != 0 ||
+      header.version != BLOOM_VERSION || header.nb_bits < 64 ||
+      (header.nb_bits & (header.nb_bits - 1)) != 0 ||
+      bloom_init(filter, header.capacity) != 0) {
+    fclose(f);
+    return -1;
+  }
+
+  if (filter->nb_bits != header.nb_bits ||
+      fread(filter->bits, sizeof(uint64_t), header.nb_bits / 64, f) !=
+          header.nb_bits / 64) {
+    fclose(f);
+    bloom_free(filter);
+    return -1;
+  }
+
+  fclose(f);
+  filter->count = header.count;
+  filter->covered = header.covered;
+  filter->dirty = false;
+  *identity = header.summary;
+  return 0;
+}
+
+int bloom_save(const char *path, bloom_filter *filter,
+               const summary_identity *identity) {
+  char tmp_path[strlen(path) + 5];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  FILE *f = fopen(tmp_path, "wb");
+  if (f == NULL) {
+    return -1;
+  }
+
+  bloom_header header = {.version = BLOOM_VERSION,
+                         .nb_bits = filter->nb_bits,
+                         .capacity = filter->capacity,
+                         .count = filter->count,
+                         .covered = filter->covered,
+                         .summary = *identity};
+  memcpy(header.magic, BLOOM_MAGIC, 4);
+
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(filter->bits, sizeof(uint64_t), filter->nb_bits / 64, f) ==
+                filter->nb_bits / 64;
+  ok = fclose(f) == 0 && ok;
+
+  if (!ok || rename(tmp_path, path) != 0) {
+    remove(tmp_path);
+    return -1;
+  }
+
+  filter->dirty = false;
+  return 0;
+}
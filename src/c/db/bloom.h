@@ -0,0 +1,24 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "summary.h"
+
+// Bloom filter of the addresses stored in a subset summary file,
+// `covered` is the size of the summary file already added to the filter
+typedef struct {
+  uint64_t *bits;
+  uint64_t nb_bits;
+  uint64_t capacity;
+  uint64_t count;
+  uint64_t covered;
+  bool dirty;
+} bloom_filter;
+
+int bloom_init(bloom_filter *filter, uint64_t capacity);
+void bloom_free(bloom_filter *filter);
+void bloom_add(bloom_filter *filter, const unsigned char *address);
+bool bloom_contains(const bloom_filter *filter, const unsigned char *address);
+int bloom_load(const char *path, bloom_filter *filter,
+               summary_identity *identity);
+int bloom_save(const char *path, bloom_filter *filter,
+               const summary_identity *identity);
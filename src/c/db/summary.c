@@ -0,0 +1,191 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "summary.h"
+
+// Bytes checksummed at both ends of the covered prefix
+#define IDENTITY_SAMPLE_SIZE 4096
+
+// Same sizes as Archethic.Crypto.hash_size/1
+int hash_size(unsigned char hash_type) {
+  switch (hash_type) {
+  case 0: // sha256
+  case 2: // sha3_256
+  case 5: // keccak256
+    return 32;
+  case 1: // sha512
+  case 3: // sha3_512
+  case 4: // blake2b
+    return 64;
+  default:
+    return -1;
+  }
+}
+
+// Return the size of the address at the beginning of the buffer,
+// 0 when the buffer is too short and -1 for an unknown hash type
+int address_size(const unsigned char *address, size_t len) {
+  if (len < 2) {
+    return 0;
+  }
+
+  int digest_size = hash_size(address[1]);
+  if (digest_size < 0) {
+    return -1;
+  }
+
+  return (size_t)(2 + digest_size) <= len ? 2 + digest_size : 0;
+}
+
+// Parse the summary entry at the given position.
+// Return the entry length, 0 when the entry is incomplete
+// and -1 when the content is corrupted
+int parse_summary_entry(const unsigned char *buf, size_t len, size_t pos,
+                        summary_entry *entry) {
+  if (pos >= len) {
+    return 0;
+  }
+
+  int address_len = address_size(buf + pos, len - pos);
+  if (address_len <= 0) {
+    return address_len;
+  }
+
+  size_t genesis_pos = pos + address_len;
+  int genesis_len = address_size(buf + genesis_pos, len - genesis_pos);
+  if (genesis_len <= 0) {
+    return genesis_len;
+  }
+
+  size_t stats_pos = genesis_pos + genesis_len;
+  if (stats_pos + 8 > len) {
+    return 0;
+  }
+
+  const unsigned char *stats = buf + stats_pos;
+  entry->address_pos = pos;
+  entry->address_len = address_len;
+  entry->genesis_pos = genesis_pos;
+  entry->genesis_len = genesis_len;
+  entry->size = (uint32_t)stats[0] << 24 | stats[1] << 16 | stats[2] << 8 |
+                stats[3];
+  entry->offset = (uint32_t)stats[4] << 24 | stats[5] << 16 | stats[6] << 8 |
+                  stats[7];
+  entry->len = address_len + genesis_len + 8;
+
+  return entry->len;
+}
+
+// The first byte of the digest is the subset, so the next 8 bytes are used
+// to identify an address in its subset
+uint64_t address_fingerprint(const unsigned char *address) {
+  uint64_t fingerprint = 0;
+  for (int i = 3; i < 11; i++) {
+    fingerprint = fingerprint << 8 | address[i];
+  }
+  return fingerprint;
+}
+
+void summary_path(char *path, size_t len, const char *chain_path, int subset,
+                  const char *suffix) {
+  snprintf(path, len, "%s/%02X-summary%s", chain_path, subset, suffix);
+}
+
+int map_file(const char *path, mapped_file *file) {
+  file->fd = open(path, O_RDONLY);
+  file->data = NULL;
+  file->size = 0;
+
+  if (file->fd < 0) {
+    return -1;
+  }
+
+  return remap_file(file);
+}
+
+// Extend the mapping when the file has grown since the last mapping
+int remap_file(mapped_file *file) {
+  struct stat st;
+  if (file->fd < 0 || fstat(file->fd, &st) != 0) {
+    return -1;
+  }
+
+  size_t size = st.st_size;
+  if (size == file->size) {
+    return 0;
+  }
+
+  if (file->data != NULL) {
+    munmap(file->data, file->size);
+    file->data = NULL;
+  }
+
+  file->size = size;
+  if (size == 0) {
+    return 0;
+  }
+
+  void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, file->fd, 0);
+  if (data == MAP_FAILED) {
+    file->size = 0;
+    return -1;
+  }
+
+  madvise(data, size, MADV_RANDOM);
+  file->data = (unsigned char *)data;
+  return 0;
+}
+
+void unmap_file(mapped_file *file) {
+  if (file->data != NULL) {
+    munmap(file->data, file->size);
+  }
+  if (file->fd >= 0) {
+    close(file->fd);
+  }
+  file->fd = -1;
+  file->data = NULL;
+  file->size = 0;
+}
+
+// FNV-1a, the checksum only has to tell apart different summary contents
+static uint64_t checksum_update(uint64_t checksum, const unsigned char *data,
+                                size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    checksum ^= data[i];
+    checksum *= 0x100000001b3;
+  }
+  return checksum;
+}
+
+// The summary files are only appended to, so the prefix covered by an index
+// keeps its inode, its beginning and its end. Sampling both ends avoids
+// reading the whole file at each opening.
+int summary_identify(const mapped_file *file, uint64_t covered,
+                     summary_identity *identity) {
+  struct stat st;
+  if (file->fd < 0 || fstat(file->fd, &st) != 0 || covered > file->size) {
+    return -1;
+  }
+
+  uint64_t checksum = checksum_update(
+      0xcbf29ce484222325, (const unsigned char *)&covered, sizeof(covered));
+
+  if (covered > 0) {
+    size_t sample =
+        covered < IDENTITY_SAMPLE_SIZE ? covered : IDENTITY_SAMPLE_SIZE;
+    checksum = checksum_update(checksum, file->data, sample);
+    checksum = checksum_update(checksum, file->data + covered - sample, sample);
+  }
+
+  identity->inode = st.st_ino;
+  identity->checksum = checksum;
+  return 0;
+}
+
+bool same_summary(const summary_identity *a, const summary_identity *b) {
+  return a->inode == b->inode && a->checksum == b->checksum;
+}
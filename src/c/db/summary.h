@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest address: curve id + hash type + 64 bytes digest
+#define MAX_ADDRESS_SIZE 66
+
+// A summary entry is encoded as:
+// <<tx_address, genesis_address, size::32, offset::32>>
+typedef struct {
+  size_t address_pos;
+  int address_len;
+  size_t genesis_pos;
+  int genesis_len;
+  uint32_t size;
+  uint32_t offset;
+  int len;
+} summary_entry;
+
+typedef struct {
+  int fd;
+  unsigned char *data;
+  size_t size;
+} mapped_file;
+
+// Identity of the prefix of a summary file covered by an index or a filter,
+// to detect a summary file replaced or rewritten since they were saved
+typedef struct {
+  uint64_t inode;
+  uint64_t checksum;
+} summary_identity;
+
+int hash_size(unsigned char hash_type);
+int address_size(const unsigned char *address, size_t len);
+int parse_summary_entry(const unsigned char *buf, size_t len, size_t pos,
+                        summary_entry *entry);
+uint64_t address_fingerprint(const unsigned char *address);
+
+void summary_path(char *path, size_t len, const char *chain_path,
+                  int subset, const char *suffix);
+int map_file(const char *path, mapped_file *file);
+int remap_file(mapped_file *file);
+void unmap_file(mapped_file *file);
+int summary_identify(const mapped_file *file, uint64_t covered,
+                     summary_identity *identity);
+bool same_summary(const summary_identity *a, const summary_identity *b);
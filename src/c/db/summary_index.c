@@ -0,0 +1,653 @@
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bloom.h"
+#include "port_stats.h"
+#include "stdio_helpers.h"
+#include "summary.h"
+#include "summary_scan.h"
+
+// Lookup of the transactions' summary entries by address.
+//
+// The subset summary files written by ChainIndex remain the source of truth
+// and are used as an append log: each subset keeps a sorted index file
+// (XX-summary.idx) of the address fingerprints with their entry offset, and
+// the entries appended after the index was written are parsed into an
+// in-memory hash table. When this table grows too much, it is merged into a
+// new sorted index file.
+//
+// A Bloom filter per subset (XX-summary.bloom) answers most lookups of
+// missing addresses without touching the summary and index files. The
+// filters are loaded at opening, completed with the entries appended since
+// they were saved and updated by the ADD requests sent on each new entry.
+//
+// The index files and the filters are saved with the identity of the
+// summary prefix they cover, and rebuilt when the summary file was replaced
+// or rewritten since.
+//
+// The SCAN request aggregates the chains' statistics loaded in memory by
+// ChainIndex at startup (see summary_scan.c).
+
+enum { OPEN = 1, LOOKUP = 2, ADD = 3, SCAN = 4 };
+
+#define INDEX_MAGIC "AESI"
+#define INDEX_VERSION 2
+#define MIN_COMPACTION_SIZE 16384
+#define INITIAL_TAIL_CAPACITY 1024
+#define MIN_BLOOM_CAPACITY 4096
+
+typedef struct {
+  uint64_t fingerprint;
+  uint64_t offset;
+} index_entry;
+
+// Index files are local to the node, integers are in the host's byte order
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint64_t covered;
+  uint64_t count;
+  summary_identity summary;
+} index_header;
+
+typedef struct {
+  bool opened;
+  mapped_file summary;
+  mapped_file index;
+
+  // Sorted entries of the index file, covering the summary until `covered`
+  const index_entry *base;
+  uint64_t base_count;
+  uint64_t covered;
+
+  // Open addressing table of the entries parsed after `covered`,
+  // offsets are stored incremented by one to keep 0 for empty slots
+  index_entry *tail;
+  size_t tail_capacity;
+  size_t tail_count;
+  size_t next_compaction;
+
+  size_t parsed;
+} subset_index;
+
+static char chain_path[4096];
+static bool path_set = false;
+static subset_index subsets[256];
+static bloom_filter blooms[256];
+
+void write_error(unsigned char *buf, char *error_message,
+                 int error_message_len);
+
+void close_subset(subset_index *s) {
+  if (s->opened) {
+    unmap_file(&s->summary);
+    unmap_file(&s->index);
+    free(s->tail);
+  }
+  memset(s, 0, sizeof(subset_index));
+  s->summary.fd = -1;
+  s->index.fd = -1;
+}
+
+void reset_tail(subset_index *s) {
+  free(s->tail);
+  s->tail = (index_entry *)calloc(INITIAL_TAIL_CAPACITY, sizeof(index_entry));
+  if (s->tail == NULL) {
+    err(EXIT_FAILURE, "cannot allocate index");
+  }
+  s->tail_capacity = INITIAL_TAIL_CAPACITY;
+  s->tail_count = 0;
+
+  s->next_compaction = s->base_count / 8;
+  if (s->next_compaction < MIN_COMPACTION_SIZE) {
+    s->next_compaction = MIN_COMPACTION_SIZE;
+  }
+}
+
+void tail_insert(subset_index *s, uint64_t fingerprint, uint64_t offset);
+
+void grow_tail(subset_index *s) {
+  index_entry *previous = s->tail;
+  size_t previous_capacity = s->tail_capacity;
+
+  s->tail_capacity *= 2;
+  s->tail = (index_entry *)calloc(s->tail_capacity, sizeof(index_entry));
+  if (s->tail == NULL) {
+    err(EXIT_FAILURE, "cannot allocate index");
+  }
+  s->tail_count = 0;
+
+  for (size_t i = 0; i < previous_capacity; i++) {
+    if (previous[i].offset != 0) {
+      tail_insert(s, previous[i].fingerprint, previous[i].offset - 1);
+    }
+  }
+  free(previous);
+}
+
+void tail_insert(subset_index *s, uint64_t fingerprint, uint64_t offset) {
+  if ((s->tail_count + 1) * 2 > s->tail_capacity) {
+    grow_tail(s);
+  }
+
+  size_t mask = s->tail_capacity - 1;
+  size_t slot = fingerprint & mask;
+  while (s->tail[slot].offset != 0) {
+    slot = (slot + 1) & mask;
+  }
+
+  s->tail[slot].fingerprint = fingerprint;
+  s->tail[slot].offset = offset + 1;
+  s->tail_count++;
+}
+
+// Map the index file if it was written for the same summary file
+void load_index(subset_index *s, int subset) {
+  char path[4200];
+  summary_path(path, sizeof(path), chain_path, subset, ".idx");
+
+  s->base = NULL;
+  s->base_count = 0;
+  s->covered = 0;
+
+  if (map_file(path, &s->index) != 0) {
+    unmap_file(&s->index);
+    return;
+  }
+
+  index_header *header = (index_header *)s->index.data;
+  summary_identity identity;
+  bool valid = s->index.size >= sizeof(index_header) &&
+               memcmp(header->magic, INDEX_MAGIC, 4) == 0 &&
+               header->version == INDEX_VERSION &&
+               s->index.size ==
+                   sizeof(index_header) + header->count * sizeof(index_entry) &&
+               summary_identify(&s->summary, header->covered, &identity) == 0 &&
+               same_summary(&identity, &header->summary);
+
+  if (!valid) {
+    unmap_file(&s->index);
+    return;
+  }
+
+  s->base = (const index_entry *)(s->index.data + sizeof(index_header));
+  s->base_count = header->count;
+  s->covered = header->covered;
+}
+
+int compare_entries(const void *a, const void *b) {
+  const index_entry *x = (const index_entry *)a;
+  const index_entry *y = (const index_entry *)b;
+
+  if (x->fingerprint != y->fingerprint) {
+    return x->fingerprint < y->fingerprint ? -1 : 1;
+  }
+  return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+// Merge the sorted base with the tail into a new index file
+bool compact(subset_index *s, int subset) {
+  index_entry *sorted_tail =
+      (index_entry *)malloc((s->tail_count + 1) * sizeof(index_entry));
+  if (sorted_tail == NULL) {
+    return false;
+  }
+
+  size_t n = 0;
+  for (size_t i = 0; i < s->tail_capacity; i++) {
+    if (s->tail[i].offset != 0) {
+      sorted_tail[n].fingerprint = s->tail[i].fingerprint;
+      sorted_tail[n].offset = s->tail[i].offset - 1;
+      n++;
+    }
+  }
+  qsort(sorted_tail, n, sizeof(index_entry), compare_entries);
+
+  char path[4200], tmp_path[4200];
+  summary_path(path, sizeof(path), chain_path, subset, ".idx");
+  summary_path(tmp_path, sizeof(tmp_path), chain_path, subset, ".idx.tmp");
+
+  FILE *f = fopen(tmp_path, "wb");
+  if (f == NULL) {
+    free(sorted_tail);
+    return false;
+  }
+
+  index_header header = {.version = INDEX_VERSION,
+                         .covered = s->parsed,
+                         .count = s->base_count + n};
+  memcpy(header.magic, INDEX_MAGIC, 4);
+
+  bool ok = summary_identify(&s->summary, s->parsed, &header.summary) == 0 &&
+            fwrite(&header, sizeof(header), 1, f) == 1;
+
+  size_t i = 0, j = 0;
+  while (ok && (i < s->base_count || j < n)) {
+    const index_entry *next;
+    if (j == n ||
+        (i < s->base_count && compare_entries(&s->base[i], &sorted_tail[j]) <= 0)) {
+      next = &s->base[i++];
+    } else {
+      next = &sorted_tail[j++];
+    }
+    ok = fwrite(next, sizeof(index_entry), 1, f) == 1;
+  }
+
+  ok = fclose(f) == 0 && ok;
+  free(sorted_tail);
+
+  if (!ok || rename(tmp_path, path) != 0) {
+    remove(tmp_path);
+    return false;
+  }
+
+  unmap_file(&s->index);
+  load_index(s, subset);
+  reset_tail(s);
+  return true;
+}
+
+void reset_bloom(bloom_filter *b, uint64_t capacity) {
+  bloom_free(b);
+  if (bloom_init(b, capacity) != 0) {
+    err(EXIT_FAILURE, "cannot allocate bloom filter");
+  }
+}
+
+// Add the summary entries not yet covered by the filter, doubling its
+// capacity when it is full
+void sync_bloom(subset_index *s, bloom_filter *b) {
+  summary_entry entry;
+  while (parse_summary_entry(s->summary.data, s->summary.size, b->covered,
+                             &entry) > 0) {
+    if (b->count == b->capacity) {
+      reset_bloom(b, b->capacity * 2);
+      continue;
+    }
+
+    bloom_add(b, s->summary.data + b->covered);
+    b->count++;
+    b->covered += entry.len;
+  }
+}
+
+// Index the entries appended to the summary file since the last lookup
+void refresh_subset(subset_index *s, int subset) {
+  if (!s->opened) {
+    char path[4200];
+    summary_path(path, sizeof(path), chain_path, subset, "");
+
+    close_subset(s);
+    if (map_file(path, &s->summary) != 0) {
+      // The subset file doesn't exist yet
+      unmap_file(&s->summary);
+      if (blooms[subset].covered > 0) {
+        reset_bloom(&blooms[subset], MIN_BLOOM_CAPACITY);
+      }
+      return;
+    }
+
+    s->opened = true;
+    load_index(s, subset);
+    s->parsed = s->covered;
+    reset_tail(s);
+  } else if (remap_file(&s->summary) != 0) {
+    return;
+  }
+
+  // The summary file was replaced by a smaller one: start over
+  if (s->summary.size < s->parsed || s->summary.size < blooms[subset].covered) {
+    close_subset(s);
+    reset_bloom(&blooms[subset], MIN_BLOOM_CAPACITY);
+    refresh_subset(s, subset);
+    return;
+  }
+
+  summary_entry entry;
+  while (parse_summary_entry(s->summary.data, s->summary.size, s->parsed,
+                             &entry) > 0) {
+    tail_insert(s, address_fingerprint(s->summary.data + s->parsed),
+                s->parsed);
+    s->parsed += entry.len;
+  }
+
+  sync_bloom(s, &blooms[subset]);
+
+  if (s->tail_count >= s->next_compaction && !compact(s, subset)) {
+    // Retry later if the index cannot be written
+    s->next_compaction = s->tail_count * 2;
+  }
+}
+
+bool entry_matches(subset_index *s, uint64_t offset,
+                   const unsigned char *address, int address_len) {
+  return offset + address_len <= s->summary.size &&
+         memcmp(s->summary.data + offset, address, address_len) == 0;
+}
+
+// Return the offset of the first summary entry of the address or -1
+int64_t lookup(subset_index *s, const unsigned char *address,
+               int address_len) {
+  uint64_t fingerprint = address_fingerprint(address);
+
+  // The base covers the oldest entries, so it is searched first
+  size_t low = 0, high = s->base_count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (s->base[mid].fingerprint < fingerprint) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  for (size_t i = low;
+       i < s->base_count && s->base[i].fingerprint == fingerprint; i++) {
+    if (entry_matches(s, s->base[i].offset, address, address_len)) {
+      return s->base[i].offset;
+    }
+  }
+
+  int64_t found = -1;
+  size_t mask = s->tail_capacity - 1;
+  for (size_t slot = fingerprint & mask; s->tail[slot].offset != 0;
+       slot = (slot + 1) & mask) {
+    uint64_t offset = s->tail[slot].offset - 1;
+    if (s->tail[slot].fingerprint == fingerprint &&
+        (found < 0 || offset < (uint64_t)found) &&
+        entry_matches(s, offset, address, address_len)) {
+      found = offset;
+    }
+  }
+
+  return found;
+}
+
+// Whether the summary file is still the one covered by the saved identity
+bool summary_unchanged(int subset, uint64_t covered,
+                       const summary_identity *saved) {
+  char path[4200];
+  summary_path(path, sizeof(path), chain_path, subset, "");
+
+  mapped_file summary;
+  summary_identity identity;
+  bool unchanged = map_file(path, &summary) == 0 &&
+                   summary_identify(&summary, covered, &identity) == 0 &&
+                   same_summary(&identity, saved);
+  unmap_file(&summary);
+  return unchanged;
+}
+
+// Load the persisted filter, or rebuild it, and cover the whole summary file
+void open_bloom(int subset) {
+  char path[4200];
+  summary_path(path, sizeof(path), chain_path, subset, ".bloom");
+
+  bloom_filter *b = &blooms[subset];
+  bloom_free(b);
+
+  summary_identity saved;
+  if (bloom_load(path, b, &saved) != 0 ||
+      !summary_unchanged(subset, b->covered, &saved)) {
+    reset_bloom(b, MIN_BLOOM_CAPACITY);
+  }
+
+  refresh_subset(&subsets[subset], subset);
+}
+
+void save_blooms() {
+  for (int i = 0; i < 256; i++) {
+    if (!blooms[i].dirty) {
+      continue;
+    }
+
+    // Empty subsets have nothing to persist
+    refresh_subset(&subsets[i], i);
+
+    summary_identity identity;
+    if (subsets[i].opened &&
+        summary_identify(&subsets[i].summary, blooms[i].covered, &identity) ==
+            0) {
+      char path[4200];
+      summary_path(path, sizeof(path), chain_path, i, ".bloom");
+      bloom_save(path, &blooms[i], &identity);
+    }
+  }
+}
+
+void open_index(unsigned char *buf, int pos, int len) {
+  int path_len = len - pos;
+  if (path_len <= 0 || path_len >= (int)sizeof(chain_path)) {
+    write_error(buf, "invalid path", 12);
+    return;
+  }
+
+  if (path_set) {
+    save_blooms();
+  }
+
+  for (int i = 0; i < 256; i++) {
+    close_subset(&subsets[i]);
+  }
+
+  memcpy(chain_path, buf + pos, path_len);
+  chain_path[path_len] = '\0';
+  path_set = true;
+
+  for (int i = 0; i < 256; i++) {
+    open_bloom(i);
+  }
+
+  unsigned char response[5];
+  memcpy(response, buf, 4);
+  response[4] = 1;
+  write_response(response, 5);
+}
+
+// A missing address is a successful lookup without data, so that the
+// errors of the index are not taken for missing addresses
+void write_not_found(unsigned char *buf) {
+  unsigned char response[5];
+  memcpy(response, buf, 4);
+  response[4] = 1;
+  write_response(response, 5);
+}
+
+void lookup_entry(unsigned char *buf, int pos, int len) {
+  if (!path_set) {
+    write_error(buf, "index not opened", 16);
+    return;
+  }
+
+  int address_len = address_size(buf + pos, len - pos);
+  if (address_len <= 0 || pos + address_len != len) {
+    write_error(buf, "invalid address", 15);
+    return;
+  }
+
+  int subset = buf[pos + 2];
+  if (!bloom_contains(&blooms[subset], buf + pos)) {
+    write_not_found(buf);
+    return;
+  }
+
+  subset_index *s = &subsets[subset];
+  refresh_subset(s, subset);
+
+  int64_t offset = s->opened ? lookup(s, buf + pos, address_len) : -1;
+  if (offset < 0) {
+    write_not_found(buf);
+    return;
+  }
+
+  summary_entry entry;
+  parse_summary_entry(s->summary.data, s->summary.size, offset, &entry);
+
+  // Encode the genesis address, the size and the offset as stored
+  int data_len = entry.genesis_len + 8;
+  int response_len = 5 + data_len;
+  unsigned char response[response_len];
+
+  memcpy(response, buf, 4);
+  response[4] = 1;
+  memcpy(response + 5, s->summary.data + entry.genesis_pos, data_len);
+
+  write_response(response, response_len);
+}
+
+// Register an address appended to its summary file, the entry is indexed
+// by the next lookup in the subset
+void add_address(unsigned char *buf, int pos, int len) {
+  if (!path_set) {
+    write_error(buf, "index not opened", 16);
+    return;
+  }
+
+  int address_len = address_size(buf + pos, len - pos);
+  if (address_len <= 0 || pos + address_len != len) {
+    write_error(buf, "invalid address", 15);
+    return;
+  }
+
+  bloom_add(&blooms[buf[pos + 2]], buf + pos);
+
+  unsigned char response[5];
+  memcpy(response, buf, 4);
+  response[4] = 1;
+  write_response(response, 5);
+}
+
+void scan_chain_stats(unsigned char *buf, int pos, int len) {
+  if (!path_set) {
+    write_error(buf, "index not opened", 16);
+    return;
+  }
+
+  if (len - pos != 8) {
+    write_error(buf, "invalid time", 12);
+    return;
+  }
+
+  uint64_t until = 0;
+  for (int i = 0; i < 8; i++) {
+    until = until << 8 | buf[pos + i];
+  }
+
+  size_t response_len;
+  unsigned char *response = scan_chains(chain_path, until, 5, &response_len);
+  if (response == NULL) {
+    write_error(buf, "cannot allocate chain stats", 27);
+    return;
+  }
+
+  // The responses are framed with a 32 bits length
+  if (response_len > INT32_MAX) {
+    free(response);
+    write_error(buf, "too many chain stats", 20);
+    return;
+  }
+
+  memcpy(response, buf, 4);
+  response[4] = 1;
+  write_response(response, (int)response_len);
+  free(response);
+}
+
+int main() {
+  for (int i = 0; i < 256; i++) {
+    close_subset(&subsets[i]);
+  }
+
+  int len = get_length();
+
+  while (len > 0) {
+
+    unsigned char *buf = (unsigned char *)malloc(len);
+    int read_bytes = read_message(buf, len);
+    uint64_t received_at = stats_now();
+
+    if (read_bytes != len) {
+      free(buf);
+      err(EXIT_FAILURE, "missing message");
+    }
+
+    if (len < 4) {
+      free(buf);
+      err(EXIT_FAILURE, "missing request id");
+    }
+    int pos = 4; // After the 32 bytes of the request id
+
+    if (len < 5) {
+      free(buf);
+      err(EXIT_FAILURE, "missing fun id");
+    }
+
+    unsigned char fun_id = buf[pos];
+    pos++;
+
+    uint64_t started_at = stats_now();
+    stats_record_queue(fun_id, received_at, started_at);
+    trace_request(received_at, started_at);
+
+    switch (fun_id) {
+    case OPEN:
+      open_index(buf, pos, len);
+      break;
+    case LOOKUP:
+      lookup_entry(buf, pos, len);
+      break;
+    case ADD:
+      add_address(buf, pos, len);
+      break;
+    case SCAN:
+      scan_chain_stats(buf, pos, len);
+      break;
+    case STATS_FUN_ID: {
+      int response_len = 0;
+      unsigned char *response = stats_encode(buf, &response_len);
+      if (response == NULL) {
+        write_error(buf, "cannot allocate stats", 21);
+      } else {
+        write_response(response, response_len);
+        free(response);
+      }
+      break;
+    }
+    default:
+      err(EXIT_FAILURE, "invalid fun id");
+    }
+
+    stats_record_service(fun_id, started_at, stats_now());
+
+    free(buf);
+    len = get_length();
+  }
+
+  if (path_set) {
+    save_blooms();
+  }
+}
+
+void write_error(unsigned char *buf, char *error_message,
+                 int error_message_len) {
+  int response_size = 5 + error_message_len;
+  unsigned char response[response_size];
+
+  // Encode the request id
+  for (int i = 0; i < 4; i++) {
+    response[i] = buf[i];
+  }
+
+  // Error response type
+  response[4] = 0;
+
+  // Encode the error message
+  for (int i = 0; i < error_message_len; i++) {
+    response[5 + i] = error_message[i];
+  }
+  write_response(response, response_size);
+}
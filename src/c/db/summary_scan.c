@@ -0,0 +1,284 @@
+#include <err.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "summary.h"
+#include "summary_scan.h"
+
+// Startup scan of the chain index: the summary files are aggregated by
+// genesis address (total size and number of transactions) and the last
+// address of each chain is read from its addresses file, both on all cores.
+//
+// The genesis addresses are sharded by their subset, so the threads
+// scanning the summary files only contend when updating the same shard.
+//
+// Each chain is encoded as:
+// <<genesis_address, size::64, nb_txs::32, last_address, last_time::64>>
+// where the last address is the genesis address at time 0 when the chain
+// has no address registered before `until`.
+
+#define INITIAL_SHARD_CAPACITY 256
+
+typedef struct {
+  unsigned char genesis[MAX_ADDRESS_SIZE];
+  int genesis_len;
+  uint64_t size;
+  uint32_t nb_txs;
+} chain_stats;
+
+typedef struct {
+  pthread_mutex_t lock;
+  chain_stats *chains;
+  size_t capacity;
+  size_t count;
+
+  unsigned char *encoded;
+  size_t encoded_len;
+} shard;
+
+typedef struct {
+  const char *chain_path;
+  uint64_t until;
+  shard shards[256];
+  atomic_int next_task;
+} scan;
+
+static chain_stats *find_slot(chain_stats *chains, size_t capacity,
+                              const unsigned char *genesis, int genesis_len) {
+  size_t mask = capacity - 1;
+  size_t slot = address_fingerprint(genesis) & mask;
+
+  while (chains[slot].genesis_len != 0 &&
+         (chains[slot].genesis_len != genesis_len ||
+          memcmp(chains[slot].genesis, genesis, genesis_len) != 0)) {
+    slot = (slot + 1) & mask;
+  }
+  return &chains[slot];
+}
+
+static void grow_shard(shard *s) {
+  size_t capacity = s->capacity == 0 ? INITIAL_SHARD_CAPACITY : s->capacity * 2;
+  chain_stats *chains = (chain_stats *)calloc(capacity, sizeof(chain_stats));
+  if (chains == NULL) {
+    err(EXIT_FAILURE, "cannot allocate chain stats");
+  }
+
+  for (size_t i = 0; i < s->capacity; i++) {
+    if (s->chains[i].genesis_len != 0) {
+      *find_slot(chains, capacity, s->chains[i].genesis,
+                 s->chains[i].genesis_len) = s->chains[i];
+    }
+  }
+
+  free(s->chains);
+  s->chains = chains;
+  s->capacity = capacity;
+}
+
+static void add_entry(scan *sc, const unsigned char *data,
+                      const summary_entry *entry) {
+  const unsigned char *genesis = data + entry->genesis_pos;
+  shard *s = &sc->shards[genesis[2]];
+
+  pthread_mutex_lock(&s->lock);
+  if ((s->count + 1) * 2 > s->capacity) {
+    grow_shard(s);
+  }
+
+  chain_stats *chain =
+      find_slot(s->chains, s->capacity, genesis, entry->genesis_len);
+  if (chain->genesis_len == 0) {
+    memcpy(chain->genesis, genesis, entry->genesis_len);
+    chain->genesis_len = entry->genesis_len;
+    s->count++;
+  }
+  chain->size += entry->size;
+  chain->nb_txs++;
+  pthread_mutex_unlock(&s->lock);
+}
+
+static void scan_summary(scan *sc, int subset) {
+  char path[4200];
+  summary_path(path, sizeof(path), sc->chain_path, subset, "");
+
+  mapped_file file;
+  if (map_file(path, &file) != 0) {
+    unmap_file(&file);
+    return;
+  }
+  madvise(file.data, file.size, MADV_SEQUENTIAL);
+
+  // A truncated or corrupted entry ends the scan, as in ChainIndex
+  size_t pos = 0;
+  summary_entry entry;
+  while (parse_summary_entry(file.data, file.size, pos, &entry) > 0) {
+    add_entry(sc, file.data, &entry);
+    pos += entry.len;
+  }
+
+  unmap_file(&file);
+}
+
+static void write_u64(unsigned char *buf, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    buf[i] = value >> (56 - 8 * i);
+  }
+}
+
+// Find the last address registered before `until` in the addresses file,
+// made of <<timestamp::64, address>> entries in chronological order
+static void encode_chain(scan *sc, const chain_stats *chain,
+                         unsigned char *out, size_t *out_len) {
+  char path[4200];
+  int n = snprintf(path, sizeof(path), "%s/", sc->chain_path);
+  for (int i = 0; i < chain->genesis_len; i++) {
+    n += snprintf(path + n, sizeof(path) - n, "%02X", chain->genesis[i]);
+  }
+  snprintf(path + n, sizeof(path) - n, "-addresses");
+
+  const unsigned char *last_address = chain->genesis;
+  int last_address_len = chain->genesis_len;
+  uint64_t last_time = 0;
+
+  mapped_file file;
+  if (map_file(path, &file) == 0) {
+    size_t pos = 0;
+    while (pos + 8 < file.size) {
+      int address_len = address_size(file.data + pos + 8, file.size - pos - 8);
+      if (address_len <= 0) {
+        break;
+      }
+
+      uint64_t timestamp = 0;
+      for (int i = 0; i < 8; i++) {
+        timestamp = timestamp << 8 | file.data[pos + i];
+      }
+      if (timestamp >= sc->until) {
+        break;
+      }
+
+      last_address = file.data + pos + 8;
+      last_address_len = address_len;
+      last_time = timestamp;
+      pos += 8 + address_len;
+    }
+  }
+
+  unsigned char *p = out + *out_len;
+  memcpy(p, chain->genesis, chain->genesis_len);
+  p += chain->genesis_len;
+  write_u64(p, chain->size);
+  p += 8;
+  p[0] = chain->nb_txs >> 24;
+  p[1] = chain->nb_txs >> 16;
+  p[2] = chain->nb_txs >> 8;
+  p[3] = chain->nb_txs;
+  p += 4;
+  memcpy(p, last_address, last_address_len);
+  p += last_address_len;
+  write_u64(p, last_time);
+  p += 8;
+
+  *out_len = p - out;
+  unmap_file(&file);
+}
+
+static void encode_shard(scan *sc, shard *s) {
+  size_t max_len = s->count * (2 * MAX_ADDRESS_SIZE + 20);
+  s->encoded = (unsigned char *)malloc(max_len + 1);
+  if (s->encoded == NULL) {
+    err(EXIT_FAILURE, "cannot allocate chain stats");
+  }
+
+  for (size_t i = 0; i < s->capacity; i++) {
+    if (s->chains[i].genesis_len != 0) {
+      encode_chain(sc, &s->chains[i], s->encoded, &s->encoded_len);
+    }
+  }
+
+  free(s->chains);
+  s->chains = NULL;
+}
+
+static void *scan_summaries_worker(void *arg) {
+  scan *sc = (scan *)arg;
+  int subset;
+  while ((subset = atomic_fetch_add(&sc->next_task, 1)) < 256) {
+    scan_summary(sc, subset);
+  }
+  return NULL;
+}
+
+static void *encode_shards_worker(void *arg) {
+  scan *sc = (scan *)arg;
+  int i;
+  while ((i = atomic_fetch_add(&sc->next_task, 1)) < 256) {
+    encode_shard(sc, &sc->shards[i]);
+  }
+  return NULL;
+}
+
+static void run_workers(scan *sc, void *(*worker)(void *)) {
+  long nb_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (nb_threads < 1) {
+    nb_threads = 1;
+  }
+  if (nb_threads > 256) {
+    nb_threads = 256;
+  }
+
+  pthread_t threads[nb_threads];
+  atomic_store(&sc->next_task, 0);
+
+  for (long i = 0; i < nb_threads; i++) {
+    if (pthread_create(&threads[i], NULL, worker, sc) != 0) {
+      err(EXIT_FAILURE, "cannot start scan");
+    }
+  }
+  for (long i = 0; i < nb_threads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+// The encoded chains are preceded by `header_len` bytes left to the caller
+unsigned char *scan_chains(const char *chain_path, uint64_t until,
+                           size_t header_len, size_t *len) {
+  scan *sc = (scan *)calloc(1, sizeof(scan));
+  if (sc == NULL) {
+    return NULL;
+  }
+  sc->chain_path = chain_path;
+  sc->until = until;
+  for (int i = 0; i < 256; i++) {
+    pthread_mutex_init(&sc->shards[i].lock, NULL);
+  }
+
+  run_workers(sc, scan_summaries_worker);
+  run_workers(sc, encode_shards_worker);
+
+  *len = header_len;
+  for (int i = 0; i < 256; i++) {
+    *len += sc->shards[i].encoded_len;
+  }
+
+  unsigned char *result = (unsigned char *)malloc(*len + 1);
+  size_t pos = header_len;
+  for (int i = 0; i < 256; i++) {
+    shard *s = &sc->shards[i];
+    if (result != NULL) {
+      memcpy(result + pos, s->encoded, s->encoded_len);
+      pos += s->encoded_len;
+    }
+    free(s->encoded);
+    pthread_mutex_destroy(&s->lock);
+  }
+
+  free(sc);
+  return result;
+}
@@ -0,0 +1,5 @@
+#include <stddef.h>
+#include <stdint.h>
+
+unsigned char *scan_chains(const char *chain_path, uint64_t until,
+                           size_t header_len, size_t *len);
@@ -0,0 +1,363 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Classical multidimensional scaling of a latency matrix into network
+// coordinates: the squared latencies are double centred and the
+// coordinates are the top eigenvectors scaled by the square root of their
+// eigenvalues.
+//
+// Only the top eigenpairs are needed, so they are extracted with the
+// Lanczos algorithm (with full reorthogonalization) instead of a full
+// eigen decomposition.
+//
+// The request is a single packet: <<nb_nodes::32, matrix::binary>> where
+// the matrix is made of nb_nodes * nb_nodes doubles (host byte order, row
+// major). The response is a packet of nb_nodes * 2 doubles: the x and y
+// coordinates of each node.
+
+#define NB_DIMENSIONS 2
+#define MAX_ITERATIONS 300
+#define CHECK_INTERVAL 8
+#define TOLERANCE 1e-10
+#define MAX_SWEEPS 100
+
+int read_exact(unsigned char *buf, size_t len) {
+  size_t got = 0;
+  while (got < len) {
+    ssize_t i = read(0, buf + got, len - got);
+    if (i <= 0) {
+      return -1;
+    }
+    got += i;
+  }
+  return 0;
+}
+
+int write_exact(const unsigned char *buf, size_t len) {
+  size_t wrote = 0;
+  while (wrote < len) {
+    ssize_t i = write(1, buf + wrote, len - wrote);
+    if (i <= 0) {
+      return -1;
+    }
+    wrote += i;
+  }
+  return 0;
+}
+
+uint32_t decode_u32(const unsigned char *buf) {
+  return (uint32_t)buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
+}
+
+// B = -0.5 * (D² - row_mean(D²) - column_mean(D²) + mean(D²)), in place
+void double_centre(double *m, int n) {
+  double *row_means = (double *)calloc(n, sizeof(double));
+  double *column_means = (double *)calloc(n, sizeof(double));
+  double total = 0;
+
+  // Row major passes only, the column means are accumulated row by row
+  for (int i = 0; i < n; i++) {
+    double *row = m + (size_t)i * n;
+    double row_sum = 0;
+    for (int j = 0; j < n; j++) {
+      double squared = row[j] * row[j];
+      row[j] = squared;
+      row_sum += squared;
+      column_means[j] += squared;
+    }
+    row_means[i] = row_sum / n;
+    total += row_sum;
+  }
+
+  for (int j = 0; j < n; j++) {
+    column_means[j] /= n;
+  }
+  double mean = total / ((double)n * n);
+
+  for (int i = 0; i < n; i++) {
+    double *row = m + (size_t)i * n;
+    double row_mean = row_means[i];
+    for (int j = 0; j < n; j++) {
+      row[j] = -0.5 * (row[j] - row_mean - column_means[j] + mean);
+    }
+  }
+
+  free(row_means);
+  free(column_means);
+}
+
+void mat_vec(const double *m, int n, const double *x, double *y) {
+  for (int i = 0; i < n; i++) {
+    const double *row = m + (size_t)i * n;
+    double sum = 0;
+    for (int j = 0; j < n; j++) {
+      sum += row[j] * x[j];
+    }
+    y[i] = sum;
+  }
+}
+
+double dot(const double *x, const double *y, int n) {
+  double sum = 0;
+  for (int i = 0; i < n; i++) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+}
+
+// Cyclic Jacobi eigen decomposition of a small symmetric matrix (destroyed),
+// the eigenvectors are the columns of `vectors`
+void jacobi_eigen(double *a, int m, double *values, double *vectors) {
+  for (int i = 0; i < m * m; i++) {
+    vectors[i] = 0;
+  }
+  for (int i = 0; i < m; i++) {
+    vectors[i * m + i] = 1;
+  }
+
+  for (int sweep = 0; sweep < MAX_SWEEPS; sweep++) {
+    double off = 0, norm = 0;
+    for (int p = 0; p < m; p++) {
+      norm += a[p * m + p] * a[p * m + p];
+      for (int q = p + 1; q < m; q++) {
+        off += a[p * m + q] * a[p * m + q];
+      }
+    }
+    if (off <= 1e-30 * norm) {
+      break;
+    }
+
+    for (int p = 0; p < m; p++) {
+      for (int q = p + 1; q < m; q++) {
+        double apq = a[p * m + q];
+        if (apq == 0) {
+          continue;
+        }
+
+        double theta = (a[q * m + q] - a[p * m + p]) / (2 * apq);
+        double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+        double c = 1 / sqrt(t * t + 1);
+        double s = t * c;
+
+        for (int k = 0; k < m; k++) {
+          double akp = a[k * m + p], akq = a[k * m + q];
+          a[k * m + p] = c * akp - s * akq;
+          a[k * m + q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < m; k++) {
+          double apk = a[p * m + k], aqk = a[q * m + k];
+          a[p * m + k] = c * apk - s * aqk;
+          a[q * m + k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < m; k++) {
+          double vkp = vectors[k * m + p], vkq = vectors[k * m + q];
+          vectors[k * m + p] = c * vkp - s * vkq;
+          vectors[k * m + q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < m; i++) {
+    values[i] = a[i * m + i];
+  }
+}
+
+// Indexes of the Ritz values sorted in descending order
+void sort_desc(const double *values, int m, int *order) {
+  for (int i = 0; i < m; i++) {
+    order[i] = i;
+  }
+  for (int i = 1; i < m; i++) {
+    int current = order[i];
+    int j = i - 1;
+    while (j >= 0 && values[order[j]] < values[current]) {
+      order[j + 1] = order[j];
+      j--;
+    }
+    order[j + 1] = current;
+  }
+}
+
+// Compute the top `k` eigenpairs (in descending order of eigenvalue) of the
+// symmetric matrix, returning the number found (less than k only when the
+// matrix rank is lower)
+int top_eigenpairs(const double *b, int n, int k, double *values,
+                   double *vectors) {
+  int max_steps = n < MAX_ITERATIONS ? n : MAX_ITERATIONS;
+
+  double *v = (double *)malloc(sizeof(double) * n * (max_steps + 1));
+  double *alpha = (double *)malloc(sizeof(double) * max_steps);
+  double *beta = (double *)malloc(sizeof(double) * max_steps);
+  double *t = (double *)malloc(sizeof(double) * max_steps * max_steps);
+  double *ritz_values = (double *)malloc(sizeof(double) * max_steps);
+  double *ritz_vectors = (double *)malloc(sizeof(double) * max_steps * max_steps);
+  int *order = (int *)malloc(sizeof(int) * max_steps);
+
+  // Deterministic pseudo random start: the constant vector is in the kernel
+  // of a double centred matrix
+  uint64_t seed = 0x9E3779B97F4A7C15;
+  for (int i = 0; i < n; i++) {
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    v[i] = (double)(seed >> 11) / (double)(1ULL << 53) - 0.5;
+  }
+  double norm = sqrt(dot(v, v, n));
+  for (int i = 0; i < n; i++) {
+    v[i] /= norm;
+  }
+
+  // Scale of the matrix to detect an invariant subspace
+  double scale = 0;
+  for (size_t i = 0; i < (size_t)n * n; i++) {
+    scale = fmax(scale, fabs(b[i]));
+  }
+
+  int steps = 0;
+  for (int j = 0; j < max_steps; j++) {
+    double *vj = v + (size_t)j * n;
+    double *w = v + (size_t)(j + 1) * n;
+
+    mat_vec(b, n, vj, w);
+    alpha[j] = dot(w, vj, n);
+
+    // Full reorthogonalization (twice is enough) against the Lanczos basis
+    for (int pass = 0; pass < 2; pass++) {
+      for (int i = 0; i <= j; i++) {
+        double *vi = v + (size_t)i * n;
+        double projection = dot(w, vi, n);
+        for (int l = 0; l < n; l++) {
+          w[l] -= projection * vi[l];
+        }
+      }
+    }
+
+    beta[j] = sqrt(dot(w, w, n));
+    steps = j + 1;
+
+    int invariant = beta[j] <= 1e-12 * (scale > 0 ? scale : 1);
+    if (invariant || steps == max_steps || (steps >= k && steps % CHECK_INTERVAL == 0)) {
+      memset(t, 0, sizeof(double) * steps * steps);
+      for (int p = 0; p < steps; p++) {
+        t[p * steps + p] = alpha[p];
+        if (p + 1 < steps) {
+          t[p * steps + p + 1] = beta[p];
+          t[(p + 1) * steps + p] = beta[p];
+        }
+      }
+      jacobi_eigen(t, steps, ritz_values, ritz_vectors);
+      sort_desc(ritz_values, steps, order);
+
+      // The residual of a Ritz pair is |beta_j * last component|
+      int converged = 1;
+      for (int i = 0; i < k && i < steps; i++) {
+        double residual = fabs(beta[j] * ritz_vectors[(steps - 1) * steps + order[i]]);
+        if (residual > TOLERANCE * fmax(fabs(ritz_values[order[0]]), 1e-300)) {
+          converged = 0;
+        }
+      }
+
+      if (invariant || steps == max_steps || converged) {
+        break;
+      }
+    }
+
+    for (int l = 0; l < n; l++) {
+      w[l] /= beta[j];
+    }
+  }
+
+  int found = steps < k ? steps : k;
+  for (int i = 0; i < found; i++) {
+    int index = order[i];
+    values[i] = ritz_values[index];
+
+    // Ritz vector: V * s
+    double *vector = vectors + (size_t)i * n;
+    for (int l = 0; l < n; l++) {
+      vector[l] = 0;
+    }
+    for (int j = 0; j < steps; j++) {
+      double s = ritz_vectors[j * steps + index];
+      double *vj = v + (size_t)j * n;
+      for (int l = 0; l < n; l++) {
+        vector[l] += s * vj[l];
+      }
+    }
+
+    // Deterministic sign: the largest component is positive
+    double largest = 0;
+    for (int l = 0; l < n; l++) {
+      if (fabs(vector[l]) > fabs(largest)) {
+        largest = vector[l];
+      }
+    }
+    if (largest < 0) {
+      for (int l = 0; l < n; l++) {
+        vector[l] = -vector[l];
+      }
+    }
+  }
+
+  free(v);
+  free(alpha);
+  free(beta);
+  free(t);
+  free(ritz_values);
+  free(ritz_vectors);
+  free(order);
+
+  return found;
+}
+
+int main() {
+  unsigned char header[8];
+  if (read_exact(header, 8) != 0) {
+    return 1;
+  }
+
+  uint32_t len = decode_u32(header);
+  uint32_t n = decode_u32(header + 4);
+  if (n == 0 || len != 4 + (uint64_t)n * n * sizeof(double)) {
+    fprintf(stderr, "invalid matrix\n");
+    return 1;
+  }
+
+  double *matrix = (double *)malloc((size_t)n * n * sizeof(double));
+  if (matrix == NULL || read_exact((unsigned char *)matrix, len - 4) != 0) {
+    fprintf(stderr, "cannot read matrix\n");
+    return 1;
+  }
+
+  double_centre(matrix, n);
+
+  double values[NB_DIMENSIONS] = {0};
+  double *vectors = (double *)calloc((size_t)n * NB_DIMENSIONS, sizeof(double));
+  top_eigenpairs(matrix, n, NB_DIMENSIONS, values, vectors);
+
+  // Row major n x 2 matrix of the coordinates
+  uint32_t response_len = n * NB_DIMENSIONS * sizeof(double);
+  unsigned char *response = (unsigned char *)malloc(4 + response_len);
+  response[0] = response_len >> 24;
+  response[1] = response_len >> 16;
+  response[2] = response_len >> 8;
+  response[3] = response_len;
+
+  for (uint32_t i = 0; i < n; i++) {
+    for (int d = 0; d < NB_DIMENSIONS; d++) {
+      double coordinate = vectors[(size_t)d * n + i] * sqrt(fabs(values[d]));
+      memcpy(response + 4 + (i * NB_DIMENSIONS + d) * sizeof(double),
+             &coordinate, sizeof(double));
+    }
+  }
+
+  int status = write_exact(response, 4 + response_len);
+
+  free(matrix);
+  free(vectors);
+  free(response);
+  return status == 0 ? 0 : 1;
+}
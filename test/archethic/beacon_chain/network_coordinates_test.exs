@@ -8,11 +8,95 @@ defmodule Archethic.BeaconChain.NetworkCoordinatesTest do
   alias Archethic.P2P.Message.NetworkStats
   alias Archethic.P2P.Node
 
+  alias Archethic.SharedSecrets
+
+  alias Archethic.TransactionChain.Transaction
+  alias Archethic.TransactionChain.Transaction.ValidationStamp
+
   doctest NetworkCoordinates
   @timeout 1_000
 
   import Mox
 
+  describe "get_matrix_coordinates/2" do
+    test "should compute natively the coordinates of the Nx decomposition, up to their sign" do
+      matrix =
+        Nx.tensor([
+          [0, 100, 150, 200, 90],
+          [100, 0, 60, 120, 110],
+          [150, 60, 0, 80, 170],
+          [200, 120, 80, 0, 210],
+          [90, 110, 170, 210, 0]
+        ])
+
+      nx_coordinates = NetworkCoordinates.get_matrix_coordinates(matrix, 11)
+      native_coordinates = NetworkCoordinates.get_matrix_coordinates(matrix, 12)
+
+      assert {5, 2} == Nx.shape(native_coordinates)
+
+      Enum.each(0..1, fn dimension ->
+        nx_column = nx_coordinates[[.., dimension]]
+        native_column = native_coordinates[[.., dimension]]
+
+        assert Nx.to_number(Nx.all_close(nx_column, native_column, atol: 1.0e-6)) == 1 or
+                 Nx.to_number(Nx.all_close(nx_column, Nx.negate(native_column), atol: 1.0e-6)) ==
+                   1
+      end)
+    end
+
+    test "should keep the Nx decomposition until the network agrees on the protocol version 12" do
+      matrix = Nx.tensor([[0, 100, 150], [100, 0, 60], [150, 60, 0]])
+
+      assert Nx.to_list(NetworkCoordinates.get_matrix_coordinates(matrix)) ==
+               Nx.to_list(NetworkCoordinates.get_matrix_coordinates(matrix, 11))
+    end
+  end
+
+  describe "get_patch_from_latencies/1" do
+    setup do
+      nss_key = SharedSecrets.genesis_address_keys().nss
+      :persistent_term.put(nss_key, "nss_genesis_address")
+      on_exit(fn -> :persistent_term.put(nss_key, nil) end)
+
+      me = self()
+
+      :telemetry.attach(
+        "network-coordinates-test",
+        [:archethic, :beacon_chain, :network_coordinates, :compute_patch],
+        fn _, _, metadata, _ -> send(me, {:compute_patch, metadata}) end,
+        nil
+      )
+
+      on_exit(fn -> :telemetry.detach("network-coordinates-test") end)
+    end
+
+    test "should compute natively once the network agreed on the protocol version 12" do
+      stub_network_protocol_version(12)
+      assert 12 == NetworkCoordinates.network_protocol_version()
+
+      matrix =
+        Nx.tensor([
+          [0, 100, 150, 200, 90],
+          [100, 0, 60, 120, 110],
+          [150, 60, 0, 80, 170],
+          [200, 120, 80, 0, 210],
+          [90, 110, 170, 210, 0]
+        ])
+
+      assert [_, _, _, _, _] = NetworkCoordinates.get_patch_from_latencies(matrix)
+      assert_received {:compute_patch, %{native?: true, matrix_size: 25}}
+    end
+
+    test "should compute with Nx while the network runs a previous protocol version" do
+      stub_network_protocol_version(11)
+
+      matrix = Nx.tensor([[0, 100, 150], [100, 0, 60], [150, 60, 0]])
+
+      assert [_, _, _] = NetworkCoordinates.get_patch_from_latencies(matrix)
+      assert_received {:compute_patch, %{native?: false}}
+    end
+  end
+
   describe "fetch_network_stats/1" do
     setup do
       beacon_nodes =
@@ -230,4 +314,14 @@ defmodule Archethic.BeaconChain.NetworkCoordinatesTest do
       [gnuplot_coordinates]
     )
   end
+
+  defp stub_network_protocol_version(protocol_version) do
+    MockDB
+    |> stub(:get_last_chain_address, fn "nss_genesis_address", _ ->
+      {"nss_last_address", DateTime.utc_now()}
+    end)
+    |> stub(:get_transaction, fn "nss_last_address", _, _ ->
+      {:ok, %Transaction{validation_stamp: %ValidationStamp{protocol_version: protocol_version}}}
+    end)
+  end
 end
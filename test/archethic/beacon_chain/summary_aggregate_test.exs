@@ -141,6 +141,30 @@ defmodule Archethic.BeaconChain.SummaryAggregateTest do
                }
                |> SummaryAggregate.aggregate()
     end
+
+    test "should elect the node availabilities by majority and consider ties as online" do
+      assert %SummaryAggregate{
+               p2p_availabilities: %{
+                 <<0>> => %{node_availabilities: <<1::1, 0::1, 1::1, 1::1, 0::1>>}
+               }
+             } =
+               %SummaryAggregate{
+                 p2p_availabilities: %{
+                   <<0>> => %{
+                     node_availabilities: [
+                       [1, 0, 1, 0, 0],
+                       [1, 0, 1, 1, 1],
+                       [0, 1, 0, 1, 0],
+                       [1, 0, 1, 0, 0]
+                     ],
+                     node_average_availabilities: [],
+                     end_of_node_synchronizations: [],
+                     network_patches: []
+                   }
+                 }
+               }
+               |> SummaryAggregate.aggregate()
+    end
   end
 
   describe "add_summary/2" do
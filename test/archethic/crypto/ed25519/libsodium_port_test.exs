@@ -33,4 +33,32 @@ defmodule Archethic.Crypto.Ed25519.LibSodiumPortTest do
               217, 162, 196, 123, 69, 88, 113, 237, 117, 246, 83, 193, 235,
               94>>} = LibSodiumPort.convert_secret_key_to_x25519(<<pub::binary, pv::binary>>)
   end
+
+  test "ephemeral_shared_key/1 should derive a shared key from single-use keypairs" do
+    {pub, pv} = :crypto.generate_key(:eddsa, :ed25519, :crypto.strong_rand_bytes(32))
+    {:ok, x25519_sk} = LibSodiumPort.convert_secret_key_to_x25519(<<pv::binary, pub::binary>>)
+
+    assert {:ok, {ephemeral_public_key1, shared_key1}} = LibSodiumPort.ephemeral_shared_key(pub)
+    assert {:ok, {ephemeral_public_key2, shared_key2}} = LibSodiumPort.ephemeral_shared_key(pub)
+
+    assert ephemeral_public_key1 != ephemeral_public_key2
+    assert shared_key1 == :crypto.compute_key(:ecdh, ephemeral_public_key1, x25519_sk, :x25519)
+    assert shared_key2 == :crypto.compute_key(:ecdh, ephemeral_public_key2, x25519_sk, :x25519)
+  end
+
+  test "ephemeral_pool_depth/0 should return the number of keypairs available" do
+    assert {:ok, depth} = LibSodiumPort.ephemeral_pool_depth()
+    assert depth in 0..256
+  end
+
+  test "stats/0 should return the native latency histograms per function" do
+    seed = :crypto.strong_rand_bytes(32)
+    {pub, _} = :crypto.generate_key(:eddsa, :ed25519, seed)
+    {:ok, _} = LibSodiumPort.convert_public_key_to_x25519(pub)
+
+    assert {:ok, %{1 => %{queue_time: %{count: count}, service_time: %{count: count}}}} =
+             LibSodiumPort.stats()
+
+    assert count >= 1
+  end
 end
@@ -26,4 +26,17 @@ defmodule Archethic.Crypto.NodeKeystore.Origin.TPMImplTest do
     {:ok, _} = TPMImpl.start_link()
     ^seed = TPMImpl.retrieve_node_seed()
   end
+
+  @tag :infrastructure
+  test "origin_public_key/0 should be served while signing is in progress" do
+    {:ok, _} = TPMImpl.start_link()
+    public_key = TPMImpl.origin_public_key()
+
+    sign_tasks =
+      Enum.map(1..5, fn _ -> Task.async(fn -> TPMImpl.sign_with_origin_key("hello") end) end)
+    assert ^public_key = TPMImpl.origin_public_key()
+    assert ^public_key = TPMImpl.origin_public_key()
+
+    Task.await_many(sign_tasks)
+  end
 end
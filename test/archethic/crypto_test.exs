@@ -46,6 +46,15 @@ defmodule CryptoTest do
     end
   end
 
+  test "ec_encrypt/2 should raise with a low order Ed25519 public key" do
+    # Encoding of the neutral point of the curve
+    low_order_public_key = <<0::8, 0::8, 1::8, 0::248>>
+
+    assert_raise ErlangError, ~r/Cannot compute the shared key/, fn ->
+      Crypto.ec_encrypt("hello", low_order_public_key)
+    end
+  end
+
   test "decrypt_and_set_storage_nonce/1 should decrypt storage nonce using node last key and and load storage nonce" do
     storage_nonce = :crypto.strong_rand_bytes(32)
 
@@ -67,6 +67,189 @@ defmodule Archethic.DB.EmbeddedImpl.ChainIndexTest do
     end
   end
 
+  describe "start_link/1 after a restart" do
+    test "should load the chains stats and last addresses", %{db_path: db_path} do
+      {:ok, pid} = ChainIndex.start_link(path: db_path)
+
+      genesis_address = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+      tx_address_1 = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+      tx_address_2 = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+      tx_address_3 = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+      other_genesis_address = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+
+      today = DateTime.utc_now() |> DateTime.truncate(:millisecond)
+      tomorrow = DateTime.add(today, 1, :day)
+
+      ChainIndex.add_tx(tx_address_1, genesis_address, 100, db_path)
+      ChainIndex.add_tx(tx_address_2, genesis_address, 200, db_path)
+      ChainIndex.add_tx(tx_address_3, other_genesis_address, 50, db_path)
+      ChainIndex.set_last_chain_address(genesis_address, tx_address_1, today, db_path)
+      ChainIndex.set_last_chain_address(genesis_address, tx_address_2, tomorrow, db_path)
+
+      GenServer.stop(pid)
+      {:ok, _pid} = ChainIndex.start_link(path: db_path)
+
+      assert {300, 2} = ChainIndex.get_file_stats(genesis_address)
+      assert {50, 1} = ChainIndex.get_file_stats(other_genesis_address)
+
+      # The addresses registered in the future are ignored
+      assert {^tx_address_1, ^today} = ChainIndex.get_last_chain_address(genesis_address, db_path)
+
+      assert {^other_genesis_address, ~U[1970-01-01 00:00:00.000Z]} =
+               ChainIndex.get_last_chain_address(other_genesis_address, db_path)
+    end
+  end
+
+  describe "get_tx_entry/2" do
+    test "should find the entries appended before and after a restart", %{db_path: db_path} do
+      {:ok, pid} = ChainIndex.start_link(path: db_path)
+      genesis_address = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+
+      addresses =
+        Enum.map(1..100, fn _ ->
+          tx_address = <<0::8, 0::8, 1::8, :crypto.strong_rand_bytes(31)::binary>>
+          ChainIndex.add_tx(tx_address, genesis_address, 100, db_path)
+          tx_address
+        end)
+
+      GenServer.stop(pid)
+      {:ok, _pid} = ChainIndex.start_link(path: db_path)
+
+      tx_address = <<0::8, 0::8, 1::8, :crypto.strong_rand_bytes(31)::binary>>
+      ChainIndex.add_tx(tx_address, genesis_address, 200, db_path)
+
+      LRU.purge(:chain_index_cache)
+
+      addresses
+      |> Enum.with_index()
+      |> Enum.each(fn {address, index} ->
+        offset = index * 100
+
+        assert {:ok, %{genesis_address: ^genesis_address, size: 100, offset: ^offset}} =
+                 ChainIndex.get_tx_entry(address, db_path)
+      end)
+
+      assert {:ok, %{genesis_address: ^genesis_address, size: 200, offset: 10_000}} =
+               ChainIndex.get_tx_entry(tx_address, db_path)
+
+      assert {:error, :not_exists} =
+               ChainIndex.get_tx_entry(
+                 <<0::8, 0::8, 1::8, :crypto.strong_rand_bytes(31)::binary>>,
+                 db_path
+               )
+    end
+  end
+
+  describe "get_tx_entry/2 after a rewrite of the summary file" do
+    test "should not use the filters saved for the previous file", %{db_path: db_path} do
+      {:ok, pid} = ChainIndex.start_link(path: db_path)
+      genesis_address = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+
+      old_addresses =
+        Enum.map(1..100, fn _ ->
+          tx_address = <<0::8, 0::8, 1::8, :crypto.strong_rand_bytes(31)::binary>>
+          ChainIndex.add_tx(tx_address, genesis_address, 100, db_path)
+          tx_address
+        end)
+
+      GenServer.stop(pid)
+
+      # Rewrite the summary file at the same size with other addresses
+      new_addresses =
+        Enum.map(1..100, fn _ -> <<0::8, 0::8, 1::8, :crypto.strong_rand_bytes(31)::binary>> end)
+
+      db_path
+      |> ChainWriter.base_chain_path()
+      |> Path.join("01-summary")
+      |> File.write!(
+        Enum.map(new_addresses, &<<&1::binary, genesis_address::binary, 100::32, 0::32>>)
+      )
+
+      {:ok, _pid} = ChainIndex.start_link(path: db_path)
+      LRU.purge(:chain_index_cache)
+
+      Enum.each(new_addresses, fn address ->
+        assert {:ok, %{genesis_address: ^genesis_address}} =
+                 ChainIndex.get_tx_entry(address, db_path)
+      end)
+
+      Enum.each(old_addresses, fn address ->
+        assert {:error, :not_exists} = ChainIndex.get_tx_entry(address, db_path)
+      end)
+    end
+  end
+
+  describe "get_tx_entry/2 after a crash of the summary index" do
+    test "should keep the tables and restart the summary index", %{db_path: db_path} do
+      {:ok, pid} = ChainIndex.start_link(path: db_path)
+      genesis_address = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+      tx_address = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+      ChainIndex.add_tx(tx_address, genesis_address, 100, db_path)
+
+      [{_, port_handler}] = :ets.lookup(:archethic_db_summary_index, :port)
+      Process.exit(port_handler, :kill)
+
+      # The lookups are answered from the summary file until the index is restarted
+      LRU.purge(:chain_index_cache)
+      assert {:ok, %{genesis_address: ^genesis_address}} =
+               ChainIndex.get_tx_entry(tx_address, db_path)
+
+      # Wait for the restart handled by the chain index
+      :sys.get_state(pid)
+
+      assert Process.alive?(pid)
+      assert [{_, new_port_handler}] = :ets.lookup(:archethic_db_summary_index, :port)
+      assert new_port_handler != port_handler
+      assert {100, 1} = ChainIndex.get_file_stats(genesis_address)
+
+      LRU.purge(:chain_index_cache)
+      assert {:ok, %{genesis_address: ^genesis_address}} =
+               ChainIndex.get_tx_entry(tx_address, db_path)
+    end
+  end
+
+  describe "get_tx_entry/2 under load" do
+    test "should answer the concurrent cache misses from the summary index", %{
+      db_path: db_path
+    } do
+      {:ok, _pid} = ChainIndex.start_link(path: db_path)
+      genesis_address = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+
+      addresses =
+        Enum.map(1..1_000, fn _ ->
+          tx_address = <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>>
+          ChainIndex.add_tx(tx_address, genesis_address, 100, db_path)
+          tx_address
+        end)
+
+      LRU.purge(:chain_index_cache)
+
+      me = self()
+
+      :telemetry.attach(
+        "chain-index-fallback-test",
+        [:archethic, :db, :summary_index, :lookup_fallback],
+        fn _, _, _, _ -> send(me, :lookup_fallback) end,
+        nil
+      )
+
+      on_exit(fn -> :telemetry.detach("chain-index-fallback-test") end)
+
+      missing_addresses =
+        Enum.map(1..1_000, fn _ -> <<0::8, 0::8, :crypto.strong_rand_bytes(32)::binary>> end)
+
+      results =
+        (addresses ++ missing_addresses)
+        |> Task.async_stream(&ChainIndex.get_tx_entry(&1, db_path), max_concurrency: 200)
+        |> Enum.map(fn {:ok, result} -> result end)
+
+      assert 1_000 ==
+               Enum.count(results, &match?({:ok, %{genesis_address: ^genesis_address}}, &1))
+      assert 1_000 == Enum.count(results, &(&1 == {:error, :not_exists}))
+      refute_received :lookup_fallback
+    end
+  end
+
   describe "set_last_chain_address/4" do
     test "should not update last transaction only if timestamp is lesser", %{db_path: db_path} do
       {:ok, _pid} = ChainIndex.start_link(path: db_path)
@@ -0,0 +1,7 @@
+defmodule Archethic.DB.EmbeddedImpl.EncodingTest do
+  use ExUnit.Case
+
+  alias Archethic.DB.EmbeddedImpl.Encoding
+
+  doctest Encoding
+end
@@ -220,6 +220,45 @@ defmodule Archethic.DB.EmbeddedTest do
     end
   end
 
+  describe "get_transaction/2 with compression" do
+    setup do
+      config = Application.get_env(:archethic, ChainWriter, [])
+      on_exit(fn -> Application.put_env(:archethic, ChainWriter, config) end)
+    end
+
+    test "should read compressed transactions mixed with raw ones", %{db_path: db_path} do
+      Application.put_env(:archethic, ChainWriter, compression: false)
+      tx1 = TransactionFactory.create_valid_transaction([], index: 0, content: "Hello")
+      :ok = EmbeddedImpl.write_transaction(tx1)
+
+      Application.put_env(:archethic, ChainWriter, compression: true)
+
+      tx2 =
+        TransactionFactory.create_valid_transaction([],
+          index: 1,
+          content: "Hello",
+          timestamp: DateTime.add(DateTime.utc_now(), 100)
+        )
+
+      :ok = EmbeddedImpl.write_transaction(tx2)
+
+      compressed_tx2 = tx2 |> Encoding.encode() |> Encoding.compress()
+      size_tx1 = Encoding.encode(tx1) |> byte_size()
+      size_tx2 = byte_size(compressed_tx2)
+      assert size_tx2 < Encoding.encode(tx2) |> byte_size()
+
+      assert {:ok, %{size: ^size_tx2, offset: ^size_tx1}} =
+               ChainIndex.get_tx_entry(tx2.address, db_path)
+
+      assert {:ok, ^tx2} = EmbeddedImpl.get_transaction(tx2.address)
+
+      assert {:ok, %Transaction{data: %TransactionData{content: "Hello"}}} =
+               EmbeddedImpl.get_transaction(tx2.address, data: [:content])
+
+      assert {[^tx1, ^tx2], false, nil} = EmbeddedImpl.get_transaction_chain(tx2.address)
+    end
+  end
+
   describe "get_beacon_summary/1" do
     test "should return an error when the summary does not exist" do
       assert {:error, :summary_not_exists} =
@@ -2,6 +2,8 @@ defmodule Archethic.ElectionTest do
   use ArchethicCase
   import ArchethicCase
 
+  alias Archethic.Crypto
+
   alias Archethic.Election
   alias Archethic.Election.StorageConstraints
   alias Archethic.Election.ValidationConstraints
@@ -404,6 +406,69 @@ defmodule Archethic.ElectionTest do
     end
   end
 
+  describe "chain_storage_election/1" do
+    test "should elect the same chain storage nodes as the node list for each address" do
+      nodes =
+        Enum.map(1..100, fn _ ->
+          %Node{
+            first_public_key: random_public_key(),
+            last_public_key: random_public_key(),
+            geo_patch: random_patch(),
+            average_availability: :rand.uniform()
+          }
+        end)
+
+      storage_election = Election.chain_storage_election(nodes)
+      %Node{first_public_key: node_key} = Enum.random(nodes)
+
+      Enum.each(1..10, fn _ ->
+        address = random_address()
+
+        assert Election.chain_storage_nodes(address, nodes) ==
+                 Election.chain_storage_nodes(address, storage_election)
+
+        assert Election.chain_storage_node?(address, node_key, nodes) ==
+                 Election.chain_storage_node?(address, node_key, storage_election)
+
+        assert nodes ==
+                 Election.chain_storage_nodes_with_type(address, :node, storage_election)
+      end)
+    end
+
+    test "should not elect any node from an empty node list" do
+      storage_election = Election.chain_storage_election([])
+
+      assert [] == Election.chain_storage_nodes(random_address(), storage_election)
+      refute Election.chain_storage_node?(random_address(), random_public_key(), storage_election)
+    end
+  end
+
+  describe "storage_nodes/3" do
+    test "should not read the geo patch of the nodes not elected" do
+      node = %Node{
+        first_public_key: random_public_key(),
+        geo_patch: "AAA",
+        average_availability: 1.0
+      }
+
+      node_without_patch = %Node{first_public_key: random_public_key(), average_availability: 1.0}
+
+      # Find an address for which the node without geo patch is sorted after the other one
+      address =
+        Stream.repeatedly(&random_address/0)
+        |> Enum.find(fn address ->
+          rotated_key(node, address) < rotated_key(node_without_patch, address)
+        end)
+
+      assert [^node] =
+               Election.storage_nodes(address, [node, node_without_patch], %StorageConstraints{
+                 number_replicas: fn _ -> 1 end,
+                 min_geo_patch: fn -> 1 end,
+                 min_geo_patch_average_availability: fn -> 0.5 end
+               })
+    end
+  end
+
   describe "storage_nodes_sorted_by_address" do
     test "should return same node with different order" do
       nodes =
@@ -521,6 +586,9 @@ defmodule Archethic.ElectionTest do
     assert Enum.all?([{88, 130, 19, 2}, {88, 130, 19, 0}], &(&1 in beacon_storage_nodes_ip))
   end
 
+  defp rotated_key(%Node{first_public_key: <<_::8, _::8, public_key::binary>>}, address),
+    do: :crypto.hash(:sha256, [public_key, address, Crypto.storage_nonce()])
+
   defp random_patch do
     list_char = Enum.concat([?0..?9, ?A..?F])
     Enum.take_random(list_char, 3) |> List.to_string()
@@ -0,0 +1,67 @@
+defmodule Archethic.Utils.PortHandlerTest do
+  use ExUnit.Case
+
+  alias Archethic.Utils.PortHandler
+
+  doctest PortHandler
+
+  describe "request/3 with coalescing" do
+    test "should answer each of the concurrent requests" do
+      program = Application.app_dir(:archethic, "/priv/c_dist/libsodium_port")
+
+      keys =
+        Enum.map(1..200, fn _ ->
+          {pub, _} = :crypto.generate_key(:eddsa, :ed25519)
+          pub
+        end)
+
+      {:ok, port_handler} = PortHandler.start_link(program: program, coalesce_window: nil)
+      expected = Enum.map(keys, &PortHandler.request(port_handler, 1, &1))
+
+      Enum.each([nil, 0, 5], fn window ->
+        {:ok, port_handler} = PortHandler.start_link(program: program, coalesce_window: window)
+
+        responses =
+          keys
+          |> Task.async_stream(&PortHandler.request(port_handler, 1, &1), max_concurrency: 50)
+          |> Enum.map(fn {:ok, response} -> response end)
+
+        assert expected == responses
+      end)
+    end
+  end
+
+  describe "request/3 with tracing" do
+    setup do
+      program = Application.app_dir(:archethic, "/priv/c_dist/libsodium_port")
+      {:ok, port_handler} = PortHandler.start_link(program: program, trace: true)
+
+      :telemetry.attach(
+        "port-handler-trace-test",
+        [:archethic, :port_handler, :request, :stop],
+        fn _, measurements, metadata, pid -> send(pid, {:trace, measurements, metadata}) end,
+        self()
+      )
+
+      on_exit(fn -> :telemetry.detach("port-handler-trace-test") end)
+
+      %{port_handler: port_handler}
+    end
+
+    test "should emit the time spent in each stage", %{port_handler: port_handler} do
+      {pub, _} = :crypto.generate_key(:eddsa, :ed25519)
+      assert {:ok, <<_::binary-32>>} = PortHandler.request(port_handler, 1, pub)
+
+      assert_receive {:trace,
+                      %{
+                        duration: duration,
+                        mailbox_time: mailbox_time,
+                        native_queue_time: native_queue_time,
+                        native_service_time: native_service_time,
+                        pipe_time: _
+                      }, %{program: "libsodium_port", function: 1}}
+
+      assert duration >= mailbox_time + native_queue_time + native_service_time
+    end
+  end
+end
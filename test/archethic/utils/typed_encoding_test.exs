@@ -30,6 +30,16 @@ defmodule Archethic.Utils.TypedEncodingTest do
     end
   end
 
+  test "serialize/2 should keep the encoding of nested values" do
+    data = [1, -256, "a", %{"k" => nil}, true]
+
+    assert <<3, 1, 5, 0, 1, 1, 1, 0, 0, 2, 1, 0, 2, 1, 1, "a", 4, 1, 1, 2, 1, 1, "k", 6, 5,
+             1>> = TypedEncoding.serialize(data, :extended)
+
+    assert <<3, 1, 5, 0, 1::1, 1, 1, 0, 0::1, 2, 1, 0, 2, 1, 1, "a", 4, 1, 1, 2, 1, 1, "k", 6,
+             5, 1::1>> = TypedEncoding.serialize(data, :compact)
+  end
+
   defp map_gen do
     StreamData.tree(
       StreamData.one_of([
@@ -1,4 +1,4 @@
-defmodule VarIntTest do
+defmodule Archethic.Utils.VarIntTest do
   use ExUnit.Case
   alias Archethic.Utils.VarInt
 
@@ -19,7 +19,7 @@ defmodule VarIntTest do
       |> Enum.map(fn x -> Integer.pow(1..2048 |> Enum.random(), x) end)
 
     # Encode the numbers in bitstrings
-    struct_nums = numbers |> Enum.map(fn x -> x |> VarInt.from_value() end)
+    serialized_numbers = numbers |> Enum.map(fn x -> x |> VarInt.from_value() end)
 
     # Deserialize the bitstrings to numbers
     decoded_numbers =
@@ -36,7 +36,7 @@ defmodule VarIntTest do
     data = <<1, 34>>
     rest = <<2, 3>>
 
-    {value, returned_rest} = VarInt.get_value(data <> rest)
+    {_value, returned_rest} = VarInt.get_value(data <> rest)
 
     assert rest == returned_rest
   end